@@ -0,0 +1,22 @@
+#include "ast.hpp"
+#include <iostream>
+
+ParsedQuery::ParsedQuery(const char* query, size_t length, const ParseOptions& options):
+    config(options.config ? options.config : NodeBin::NewConfig(options)),
+    ownsConfig(!options.config),
+    result(NULL) {
+  if (config == NULL)
+    return;
+
+  uint_fast32_t flags = options.parseOnlyStatements ? CYPHER_PARSE_ONLY_STATEMENTS : 0;
+  result = cypher_uparse(query, length, NULL, config, flags);
+  if (result == NULL)
+    std::cerr << "cypher_uparse" << std::endl;
+}
+
+ParsedQuery::~ParsedQuery() {
+  if (result)
+    cypher_parse_result_free(result);
+  if (config && ownsConfig)
+    cypher_parser_config_free(config);
+}
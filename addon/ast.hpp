@@ -0,0 +1,69 @@
+#ifndef __AST_HPP__
+#define __AST_HPP__
+
+#include <utility>
+#include <vector>
+#include <cypher-parser.h>
+#include "parser.hpp"
+
+// A query parsed without building a result tree, for analyses reading the libcypher-parser
+// AST directly on the worker thread.
+class ParsedQuery {
+public:
+  ParsedQuery(const char* query, size_t length, const ParseOptions& options);
+  ~ParsedQuery();
+
+  bool Parsed() const { return result != NULL; }
+  unsigned int Errors() const { return cypher_parse_result_nerrors(result); }
+
+  // Visits every node depth first, in source order, until visit returns false.
+  template <class Visitor>
+  bool ForEachNode(Visitor visit) const {
+    std::vector<const cypher_astnode_t*> stack;
+    for (unsigned int i = cypher_parse_result_nroots(result); i > 0; i--)
+      stack.push_back(cypher_parse_result_get_root(result, i - 1));
+
+    while (!stack.empty()) {
+      auto node = stack.back();
+      stack.pop_back();
+      if (!visit(node))
+        return false;
+      for (unsigned int i = cypher_astnode_nchildren(node); i > 0; i--)
+        stack.push_back(cypher_astnode_get_child(node, i - 1));
+    }
+    return true;
+  }
+
+  // Calls enter and leave around every node depth first, in source order.
+  template <class Enter, class Leave>
+  void ForEachNode(Enter enter, Leave leave) const {
+    // Nodes to enter, and nodes to leave once their children are done.
+    std::vector<std::pair<const cypher_astnode_t*, bool>> stack;
+    for (unsigned int i = cypher_parse_result_nroots(result); i > 0; i--)
+      stack.emplace_back(cypher_parse_result_get_root(result, i - 1), false);
+
+    while (!stack.empty()) {
+      auto node = stack.back().first;
+      auto entered = stack.back().second;
+      stack.pop_back();
+      if (entered) {
+        leave(node);
+        continue;
+      }
+      enter(node);
+      stack.emplace_back(node, true);
+      for (unsigned int i = cypher_astnode_nchildren(node); i > 0; i--)
+        stack.emplace_back(cypher_astnode_get_child(node, i - 1), false);
+    }
+  }
+
+private:
+  ParsedQuery(const ParsedQuery&) = delete;
+  ParsedQuery& operator=(const ParsedQuery&) = delete;
+
+  cypher_parser_config_t* config;
+  bool ownsConfig;
+  cypher_parse_result_t* result;
+};
+
+#endif //__AST_HPP__
@@ -0,0 +1,117 @@
+#include "binary.hpp"
+#include <cstdint>
+#include <cstring>
+
+namespace BinaryFormat {
+
+static void WriteUVarint(uint64_t value, std::string& output) {
+  while (value >= 0x80) {
+    output += (char)(value | 0x80);
+    value >>= 7;
+  }
+  output += (char)value;
+}
+
+struct Ranges {
+  explicit Ranges(const std::string& key): key(key) {}
+
+  const std::string& key;
+  std::vector<uint32_t> starts;
+  std::vector<uint32_t> ends;
+};
+
+static bool IsRange(const rapidjson::Value& value) {
+  return value.IsArray() && value.Size() == 2 && value[0].IsUint() && value[1].IsUint();
+}
+
+static void WriteTable(const std::vector<uint32_t>& table, std::string& output) {
+  if (!table.empty())
+    output.append((const char*)table.data(), table.size() * sizeof(uint32_t));
+}
+
+static void WriteValue(const rapidjson::Value& value, const NameIndex& names, Ranges& ranges, std::string& output) {
+  switch (value.GetType()) {
+  case rapidjson::kNullType:
+    output += (char)Null;
+    break;
+  case rapidjson::kFalseType:
+    output += (char)False;
+    break;
+  case rapidjson::kTrueType:
+    output += (char)True;
+    break;
+  case rapidjson::kNumberType:
+    if (value.IsInt()) {
+      auto number = (uint32_t)value.GetInt();
+      output += (char)Int32;
+      for (int i = 0; i < 4; i++)
+        output += (char)(number >> (i * 8));
+    }
+    else {
+      uint64_t bits;
+      auto number = value.GetDouble();
+      memcpy(&bits, &number, sizeof(bits));
+      output += (char)Double;
+      for (int i = 0; i < 8; i++)
+        output += (char)(bits >> (i * 8));
+    }
+    break;
+  case rapidjson::kStringType: {
+    auto id = names.Find(value.GetString(), value.GetStringLength());
+    if (id != -1) {
+      output += (char)Name;
+      WriteUVarint(id, output);
+    }
+    else {
+      output += (char)String;
+      WriteUVarint(value.GetStringLength(), output);
+      output.append(value.GetString(), value.GetStringLength());
+    }
+    break;
+  }
+  case rapidjson::kArrayType:
+    output += (char)Array;
+    WriteUVarint(value.Size(), output);
+    for (auto& element : value.GetArray())
+      WriteValue(element, names, ranges, output);
+    break;
+  case rapidjson::kObjectType:
+    output += (char)Object;
+    WriteUVarint(value.MemberCount(), output);
+    for (auto& member : value.GetObject()) {
+      auto id = names.Find(member.name.GetString(), member.name.GetStringLength());
+      if (id != -1)
+        WriteUVarint((uint64_t)id << 1, output);
+      else {
+        WriteUVarint((uint64_t)member.name.GetStringLength() << 1 | 1, output);
+        output.append(member.name.GetString(), member.name.GetStringLength());
+      }
+      if (member.name.GetStringLength() == ranges.key.length() && ranges.key == member.name.GetString()
+          && IsRange(member.value)) {
+        output += (char)Range;
+        WriteUVarint(ranges.starts.size(), output);
+        ranges.starts.push_back(member.value[0].GetUint());
+        ranges.ends.push_back(member.value[1].GetUint());
+      }
+      else
+        WriteValue(member.value, names, ranges, output);
+    }
+    break;
+  }
+}
+
+void Write(const rapidjson::Value& value, const NameIndex& names, const std::string& rangeKey, std::string& output) {
+  Ranges ranges(rangeKey);
+  output.append(magic, sizeof(magic) - 1);
+  output += (char)version;
+  WriteValue(value, names, ranges, output);
+
+  output.append((4 - output.size() % 4) % 4, '\0');
+  WriteTable(ranges.starts, output);
+  WriteTable(ranges.ends, output);
+  auto count = (uint32_t)ranges.starts.size();
+  for (int i = 0; i < 4; i++)
+    output += (char)(count >> (i * 8));
+}
+
+}
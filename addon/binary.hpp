@@ -0,0 +1,33 @@
+#ifndef __BINARY_HPP__
+#define __BINARY_HPP__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "rapidjson/document.h"
+#include "names.hpp"
+
+// Result trees in a compact binary form, sent between threads as one buffer and read back
+// by decode in index.ts. Layout, after the "CYPB" magic and a version byte, is a tagged value:
+//   0 null, 1 false, 2 true, 3 int32, 4 double, both little endian,
+//   5 known name: uvarint id, 6 string: uvarint byte length and utf-8 bytes,
+//   7 array: uvarint count and elements, 8 object: uvarint count and members,
+//   9 range: uvarint index into the range tables.
+// Member keys are a uvarint, id << 1 for known names, or byte length << 1 | 1 followed by the bytes.
+// Ids are positions in the names list exported by the addon.
+// Node ranges follow the tree, padded to a multiple of 4 bytes: the start offsets of all ranges,
+// then their end offsets, each a uint32 in the byte order of the platform, so decode reads them
+// as Uint32Arrays over the buffer. The last 4 bytes are the number of ranges, little endian.
+namespace BinaryFormat {
+  const char magic[] = "CYPB";
+  const unsigned char version = 2;
+
+  enum Tag : unsigned char {
+    Null, False, True, Int32, Double, Name, String, Array, Object, Range
+  };
+
+  // Members named rangeKey holding a start and an end offset are written to the range tables.
+  void Write(const rapidjson::Value& value, const NameIndex& names, const std::string& rangeKey, std::string& output);
+}
+
+#endif //__BINARY_HPP__
@@ -1,51 +1,272 @@
 #include <nan.h>
+#include <algorithm>
 #include "parser.hpp"
+#include "document.hpp"
+#include "handle.hpp"
+#include "keys.hpp"
+#include "summary.hpp"
+#include "classify.hpp"
+#include "cost.hpp"
+#include "lint.hpp"
+#include "schema.hpp"
+#include "visit.hpp"
+#include "selector.hpp"
+#include "rewrite.hpp"
+#include "binary.hpp"
+#include "cbor.hpp"
 
 using namespace Nan;
 using namespace std;
 using namespace v8;
 
+// State of one instance of the addon. Every worker thread loading the module gets its
+// own, freed along with its environment.
+struct AddonData {
+  explicit AddonData(Isolate* isolate): keys(isolate) {}
+
+  KeyTable keys;
+  ParserMetrics metrics;
+  // Tells compiled schemas passed as options from other objects.
+  v8::Global<FunctionTemplate> schemaTemplate;
+  v8::Global<FunctionTemplate> selectorTemplate;
+};
+
+// Form of parse results passed to callbacks. Buffer and binary results are one ArrayBuffer,
+// which worker threads can transfer to another thread without copying. Cbor results are a
+// Buffer encoded straight from the walk of the AST.
+enum class OutputFormat {
+  Object,
+  Json,
+  Buffer,
+  Binary,
+  Cbor
+};
+
+Local<Value> NewArrayBuffer(const string& data) {
+  auto buffer = ArrayBuffer::New(Isolate::GetCurrent(), data.size());
+  TypedArrayContents<uint8_t> contents(Uint8Array::New(buffer, 0, data.size()));
+  memcpy(*contents, data.data(), data.size());
+  return buffer;
+}
+
+void DeleteString(char*, void* hint) {
+  delete static_cast<string*>(hint);
+}
+
+// Hands the output over to a Buffer without copying it.
+Local<Value> NewBuffer(string& data) {
+  auto owned = new string(std::move(data));
+  return Nan::NewBuffer(&(*owned)[0], owned->size(), DeleteString, owned).ToLocalChecked();
+}
+
 class CypherParserWorker : public AsyncWorker {
 public:
-  CypherParserWorker(const string& query, unsigned int width, bool dumpAst, bool rawJson, bool colorize, bool parseOnlyStatements, Callback *callback)
-  : AsyncWorker(callback), query(query), width(width), dumpAst(dumpAst), rawJson(rawJson), colorize(colorize), parseOnlyStatements(parseOnlyStatements) {}
+  CypherParserWorker(const KeyTable& keys, ParserMetrics* metrics, const string& query, const ParseOptions& options,
+                     OutputFormat format, Callback *callback)
+  : AsyncWorker(callback), keys(keys), metrics(metrics), query(query), options(options), format(format) {}
 
   ~CypherParserWorker() {}
 
   void Execute () {
-    succeeded = NodeBin::Parse(json, query, width, dumpAst, colorize, parseOnlyStatements);
+    auto started = chrono::steady_clock::now();
+    if (format == OutputFormat::Cbor) {
+      CborWriter writer(output);
+      succeeded = NodeBin::Parse(writer, query.c_str(), query.length(), options);
+      if (output.empty())
+        SetErrorMessage("Could not parse query.");
+    }
+    else {
+      auto parsed = make_shared<ParseTree>();
+      succeeded = NodeBin::Parse(*parsed, query.c_str(), query.length(), options);
+      tree = parsed;
+      Serialize();
+    }
+    metrics->Record(query.length(), chrono::steady_clock::now() - started, succeeded);
   }
   
   void HandleOKCallback () {
     Nan::HandleScope scope;
-    Nan::JSON NanJSON;
-    auto json = New(this->json.c_str());
-    if (!json.IsEmpty()) {
-      Nan::MaybeLocal<v8::Value> succeeded = Nan::New(this->succeeded);
-      Nan::MaybeLocal<v8::Value> result;
+    Local<Value> result;
+    switch (format) {
+    case OutputFormat::Object:
+      result = keys.Build(tree->document, options.fixedShapes);
+      break;
+    case OutputFormat::Json:
+      result = New(output).ToLocalChecked();
+      break;
+    case OutputFormat::Buffer:
+    case OutputFormat::Binary:
+      result = NewArrayBuffer(output);
+      break;
+    case OutputFormat::Cbor:
+      result = NewBuffer(output);
+      break;
+    }
 
-      if (rawJson)
-        result = json.ToLocalChecked();
-      else
-        result = NanJSON.Parse(json.ToLocalChecked());
+    Local<Value> argv[] = {
+      New(succeeded),
+      result
+    };
+    AsyncResource resource("cypher-parser-callback");
+    resource.runInAsyncScope(GetCurrentContext()->Global(), **callback, 2, argv);
+  }
 
-      Local<Value> argv[] = {
-        succeeded.ToLocalChecked(),
-        result.ToLocalChecked()
-      };
-      AsyncResource resource("cypher-parser-callback");
-      resource.runInAsyncScope(GetCurrentContext()->Global(), **callback, 2, argv);
-    }
+  void HandleErrorCallback () {
+    Nan::HandleScope scope;
+    Local<Value> argv[] = {
+      New(false),
+      Nan::Error(ErrorMessage())
+    };
+    AsyncResource resource("cypher-parser-callback");
+    resource.runInAsyncScope(GetCurrentContext()->Global(), **callback, 2, argv);
   }
   
+protected:
+  // Result trees are turned into JS objects on the main thread, only json text and binary
+  // output are made here.
+  void Serialize() {
+    if (!tree || !tree->document.IsObject())
+      SetErrorMessage("Could not parse query.");
+    else if (format == OutputFormat::Json || format == OutputFormat::Buffer)
+      output = NodeBin::GetJsonText(tree->document);
+    else if (format == OutputFormat::Binary)
+      BinaryFormat::Write(tree->document, keys.Names(), NodeBin::KeyName("range", options.compact), output);
+    else if (format == OutputFormat::Cbor) {
+      CborWriter writer(output);
+      tree->document.Accept(writer);
+    }
+  }
+
+  const KeyTable& keys;
+  ParserMetrics* metrics;
+  string query;
+  ParseOptions options;
+  OutputFormat format;
+  shared_ptr<const ParseTree> tree;
+  string output;
+  bool succeeded;
+};
+
+class CypherFileParserWorker : public CypherParserWorker {
+public:
+  CypherFileParserWorker(const KeyTable& keys, const string& path, const ParseOptions& options, OutputFormat format, Callback *callback)
+  : CypherParserWorker(keys, NULL, string(), options, format, callback), path(path) {}
+
+  ~CypherFileParserWorker() {}
+
+  void Execute () {
+    string error;
+    if (format == OutputFormat::Cbor) {
+      CborWriter writer(output);
+      succeeded = NodeBin::ParseFile(writer, path, options, error);
+      if (!error.empty())
+        SetErrorMessage(error.c_str());
+      else if (output.empty())
+        SetErrorMessage("Could not parse query.");
+      return;
+    }
+
+    auto parsed = make_shared<ParseTree>();
+    succeeded = NodeBin::ParseFile(*parsed, path, options, error);
+    tree = parsed;
+    if (!error.empty())
+      SetErrorMessage(error.c_str());
+    else
+      Serialize();
+  }
+
 private:
+  string path;
+};
+
+class CypherVisitWorker : public CypherParserWorker {
+public:
+  CypherVisitWorker(const KeyTable& keys, const string& query, const ParseOptions& options, const NodeTypeSet& types,
+                    Callback *callback)
+  : CypherParserWorker(keys, NULL, query, options, OutputFormat::Object, callback), types(types) {}
+
+  ~CypherVisitWorker() {}
+
+  void Execute () {
+    auto parsed = make_shared<ParseTree>();
+    succeeded = NodeBin::Visit(*parsed, query.c_str(), query.length(), options, types);
+    tree = parsed;
+    Serialize();
+  }
+
+private:
+  NodeTypeSet types;
+};
+
+class CypherSelectWorker : public CypherParserWorker {
+public:
+  CypherSelectWorker(const KeyTable& keys, const string& query, const ParseOptions& options,
+                     const vector<shared_ptr<const Selector>>& selectors, Callback *callback)
+  : CypherParserWorker(keys, NULL, query, options, OutputFormat::Object, callback), selectors(selectors) {}
+
+  ~CypherSelectWorker() {}
+
+  void Execute () {
+    auto parsed = make_shared<ParseTree>();
+    succeeded = NodeBin::Select(*parsed, query.c_str(), query.length(), options, selectors);
+    tree = parsed;
+    Serialize();
+  }
+
+private:
+  vector<shared_ptr<const Selector>> selectors;
+};
+
+class CypherSplitWorker : public AsyncWorker {
+public:
+  CypherSplitWorker(const KeyTable& keys, const string& query, bool parseOnlyStatements, Callback *callback)
+  : AsyncWorker(callback), keys(keys), query(query), parseOnlyStatements(parseOnlyStatements) {}
+
+  ~CypherSplitWorker() {}
+
+  void Execute () {
+    succeeded = NodeBin::Split(segments, query.c_str(), query.length(), parseOnlyStatements);
+
+    // Segment offsets are utf-8 byte offsets, convert them to utf-16 string indices
+    // so js can slice the input without copying it.
+    Utf16Index index;
+    index.Build(query.c_str(), query.length());
+    for (auto& segment : segments) {
+      segment.start = index.Map(segment.start);
+      segment.end = index.Map(segment.end);
+    }
+  }
+
+  void HandleOKCallback () {
+    Nan::HandleScope scope;
+    auto start = keys.Get("start");
+    auto end = keys.Get("end");
+    auto type = keys.Get("type");
+    auto statement = keys.Get("statement");
+    auto command = keys.Get("command");
+
+    auto result = New<Array>(segments.size());
+    for (size_t i = 0; i < segments.size(); i++) {
+      auto segment = New<Object>();
+      Nan::Set(segment, start, New<Number>((double)segments[i].start));
+      Nan::Set(segment, end, New<Number>((double)segments[i].end));
+      Nan::Set(segment, type, segments[i].command ? command : statement);
+      Nan::Set(result, i, segment);
+    }
+
+    Local<Value> argv[] = {
+      New(succeeded),
+      result
+    };
+    AsyncResource resource("cypher-parser-callback");
+    resource.runInAsyncScope(GetCurrentContext()->Global(), **callback, 2, argv);
+  }
+
+private:
+  const KeyTable& keys;
   string query;
-  unsigned int width;
-  bool dumpAst;
-  bool rawJson;
-  bool colorize;
   bool parseOnlyStatements;
-  string json;
+  vector<QuerySegment> segments;
   bool succeeded;
 };
 
@@ -81,6 +302,22 @@ unsigned int GetOptionalUIntParam(const char* name, Local<Object>& object, unsig
   return defaultValue;
 }
 
+double GetOptionalNumberParam(const char* name, Local<Object>& object, double defaultValue) {
+  auto key = Nan::New(name).ToLocalChecked();
+  if (object->Has(Nan::GetCurrentContext(), key).FromJust()) {
+    auto val = object->Get(Nan::GetCurrentContext(), key).ToLocalChecked();
+    if (!val->IsNumber()) {
+      std::string msg = "Property ";
+      msg += name;
+      msg += " must be a number.";
+      ThrowError(msg.c_str());
+      return defaultValue;
+    }
+    return val->NumberValue(Nan::GetCurrentContext()).FromJust();
+  }
+  return defaultValue;
+}
+
 bool GetOptionalBoolParam(const char* name, Local<Object>& object, bool defaultValue) {
   auto key = Nan::New(name).ToLocalChecked();
   if (object->Has(Nan::GetCurrentContext(), key).FromJust()) {
@@ -97,15 +334,407 @@ bool GetOptionalBoolParam(const char* name, Local<Object>& object, bool defaultV
   return defaultValue;
 }
 
+struct cypher_input_position GetOptionalPositionParam(const char* name, Local<Object>& object, const struct cypher_input_position& defaultValue) {
+  auto key = Nan::New(name).ToLocalChecked();
+  if (object->Has(Nan::GetCurrentContext(), key).FromJust()) {
+    auto val = object->Get(Nan::GetCurrentContext(), key).ToLocalChecked();
+    if (!val->IsObject()) {
+      std::string msg = "Property ";
+      msg += name;
+      msg += " must be an object.";
+      ThrowError(msg.c_str());
+      return defaultValue;
+    }
+    auto position = val->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
+    return {
+      GetOptionalUIntParam("line", position, defaultValue.line),
+      GetOptionalUIntParam("column", position, defaultValue.column),
+      GetOptionalUIntParam("offset", position, (unsigned int)defaultValue.offset)
+    };
+  }
+  return defaultValue;
+}
+
+CostWeights GetOptionalWeightsParam(const char* name, Local<Object>& object, const CostWeights& defaultValue) {
+  auto key = Nan::New(name).ToLocalChecked();
+  if (object->Has(Nan::GetCurrentContext(), key).FromJust()) {
+    auto val = object->Get(Nan::GetCurrentContext(), key).ToLocalChecked();
+    if (!val->IsObject()) {
+      std::string msg = "Property ";
+      msg += name;
+      msg += " must be an object.";
+      ThrowError(msg.c_str());
+      return defaultValue;
+    }
+    auto weights = val->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
+    CostWeights result;
+    result.unboundedRange = GetOptionalNumberParam("unboundedRange", weights, defaultValue.unboundedRange);
+    result.rangeHop = GetOptionalNumberParam("rangeHop", weights, defaultValue.rangeHop);
+    result.cartesianProduct = GetOptionalNumberParam("cartesianProduct", weights, defaultValue.cartesianProduct);
+    result.unwindElement = GetOptionalNumberParam("unwindElement", weights, defaultValue.unwindElement);
+    return result;
+  }
+  return defaultValue;
+}
+
+OutputFormat GetOptionalFormatParam(const char* name, Local<Object>& object, OutputFormat defaultValue) {
+  static const char* const formats[] = { "object", "json", "buffer", "binary", "cbor" };
+  Local<Value> none;
+  auto val = GetOptionalStringParam(name, object, none);
+  if (val.IsEmpty())
+    return defaultValue;
+
+  Utf8String format(val);
+  for (size_t i = 0; i < sizeof(formats) / sizeof(*formats); i++) {
+    if (!strcmp(*format, formats[i]))
+      return (OutputFormat)i;
+  }
+  std::string msg = "Property ";
+  msg += name;
+  msg += " must be one of object, json, buffer, binary or cbor.";
+  ThrowError(msg.c_str());
+  return defaultValue;
+}
+
+unsigned int GetOptionalLintParam(const char* name, Local<Object>& object, unsigned int defaultValue) {
+  auto key = Nan::New(name).ToLocalChecked();
+  if (!object->Has(Nan::GetCurrentContext(), key).FromJust())
+    return defaultValue;
+
+  std::string msg = "Property ";
+  msg += name;
+  msg += " must be an array of rule names:";
+  for (auto rule : Linter::RuleNames()) {
+    msg += " ";
+    msg += rule;
+  }
+  msg += ".";
+
+  auto val = object->Get(Nan::GetCurrentContext(), key).ToLocalChecked();
+  if (!val->IsArray()) {
+    ThrowError(msg.c_str());
+    return defaultValue;
+  }
+
+  unsigned int rules = 0;
+  auto array = val.As<Array>();
+  for (unsigned int i = 0; i < array->Length(); i++) {
+    auto item = Nan::Get(array, i).ToLocalChecked();
+    unsigned int bit = 0;
+    if (item->IsString())
+      bit = Linter::RuleBit(*Utf8String(item));
+    if (!bit) {
+      ThrowError(msg.c_str());
+      return defaultValue;
+    }
+    rules |= bit;
+  }
+  return rules;
+}
+
+bool GetTypesParam(const char* name, Local<Object>& object, NodeTypeSet& types) {
+  std::string msg = "Property ";
+  msg += name;
+  msg += " must be a non-empty array of AST node type names.";
+
+  auto key = Nan::New(name).ToLocalChecked();
+  auto val = object->Get(Nan::GetCurrentContext(), key).ToLocalChecked();
+  if (!val->IsArray() || !val.As<Array>()->Length()) {
+    ThrowError(msg.c_str());
+    return false;
+  }
+
+  auto array = val.As<Array>();
+  for (unsigned int i = 0; i < array->Length(); i++) {
+    auto item = Nan::Get(array, i).ToLocalChecked();
+    if (!item->IsString() || !types.Add(*Utf8String(item))) {
+      msg = "Unknown AST node type in property ";
+      msg += name;
+      msg += ".";
+      ThrowError(msg.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+// Reads a map of names, each to an array of its property keys.
+bool GetSchemaDefinition(const char* name, Local<Object>& object, GraphSchema::Definition& definition) {
+  auto key = Nan::New(name).ToLocalChecked();
+  if (!object->Has(Nan::GetCurrentContext(), key).FromJust())
+    return true;
+
+  std::string msg = "Property ";
+  msg += name;
+  msg += " must be an object mapping names to arrays of property keys.";
+
+  auto val = object->Get(Nan::GetCurrentContext(), key).ToLocalChecked();
+  if (!val->IsObject()) {
+    ThrowError(msg.c_str());
+    return false;
+  }
+
+  auto map = val->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
+  auto names = Nan::GetOwnPropertyNames(map).ToLocalChecked();
+  for (unsigned int i = 0; i < names->Length(); i++) {
+    auto entryName = Nan::Get(names, i).ToLocalChecked();
+    auto properties = Nan::Get(map, entryName).ToLocalChecked();
+    if (!properties->IsArray()) {
+      ThrowError(msg.c_str());
+      return false;
+    }
+
+    definition.emplace_back(*Utf8String(entryName), std::vector<std::string>());
+    auto array = properties.As<Array>();
+    for (unsigned int j = 0; j < array->Length(); j++) {
+      auto property = Nan::Get(array, j).ToLocalChecked();
+      if (!property->IsString()) {
+        ThrowError(msg.c_str());
+        return false;
+      }
+      definition.back().second.push_back(*Utf8String(property));
+    }
+  }
+  return true;
+}
+
+class CypherSchema : public ObjectWrap {
+public:
+  static void Init(Local<Object> target, Local<Value> data, AddonData& addon) {
+    auto tpl = Nan::New<FunctionTemplate>(New, data);
+    tpl->SetClassName(Nan::New("GraphSchema").ToLocalChecked());
+    tpl->InstanceTemplate()->SetInternalFieldCount(1);
+    addon.schemaTemplate.Reset(Isolate::GetCurrent(), tpl);
+    Nan::Set(target, Nan::New("GraphSchema").ToLocalChecked(), GetFunction(tpl).ToLocalChecked());
+  }
+
+  const std::shared_ptr<const GraphSchema>& Schema() const { return schema; }
+
+private:
+  CypherSchema(const std::shared_ptr<const GraphSchema>& schema): schema(schema) {}
+  ~CypherSchema() {}
+
+  static NAN_METHOD(New) {
+    if (!info.IsConstructCall()) {
+      ThrowError("GraphSchema must be called with new.");
+      return;
+    }
+
+    if (!info[0]->IsObject()) {
+      ThrowError("Parameter definition must be an object.");
+      return;
+    }
+
+    auto object = info[0]->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
+    GraphSchema::Definition labels, relTypes;
+    if (!GetSchemaDefinition("labels", object, labels) || !GetSchemaDefinition("relTypes", object, relTypes))
+      return;
+
+    auto graphSchema = std::make_shared<const GraphSchema>(labels, relTypes);
+    auto wrapper = new CypherSchema(graphSchema);
+    wrapper->Wrap(info.This());
+    Nan::Set(info.This(), Nan::New("labels").ToLocalChecked(), Nan::New<Number>((double)graphSchema->Labels().Size()));
+    Nan::Set(info.This(), Nan::New("relTypes").ToLocalChecked(), Nan::New<Number>((double)graphSchema->RelTypes().Size()));
+    Nan::Set(info.This(), Nan::New("properties").ToLocalChecked(), Nan::New<Number>((double)graphSchema->Properties().Size()));
+    info.GetReturnValue().Set(info.This());
+  }
+
+  std::shared_ptr<const GraphSchema> schema;
+};
+
+std::shared_ptr<const GraphSchema> GetOptionalSchemaParam(const AddonData& addon, const char* name, Local<Object>& object,
+                                                          const std::shared_ptr<const GraphSchema>& defaultValue) {
+  auto key = Nan::New(name).ToLocalChecked();
+  if (object->Has(Nan::GetCurrentContext(), key).FromJust()) {
+    auto val = object->Get(Nan::GetCurrentContext(), key).ToLocalChecked();
+    auto schemaTemplate = Local<FunctionTemplate>::New(Isolate::GetCurrent(), addon.schemaTemplate);
+    if (!schemaTemplate->HasInstance(val)) {
+      std::string msg = "Property ";
+      msg += name;
+      msg += " must be a schema made by compileSchema.";
+      ThrowError(msg.c_str());
+      return defaultValue;
+    }
+    return ObjectWrap::Unwrap<CypherSchema>(val.As<Object>())->Schema();
+  }
+  return defaultValue;
+}
+
+class CypherSelector : public ObjectWrap {
+public:
+  static void Init(Local<Object> target, Local<Value> data, AddonData& addon) {
+    auto tpl = Nan::New<FunctionTemplate>(New, data);
+    tpl->SetClassName(Nan::New("Selector").ToLocalChecked());
+    tpl->InstanceTemplate()->SetInternalFieldCount(1);
+    addon.selectorTemplate.Reset(Isolate::GetCurrent(), tpl);
+    Nan::Set(target, Nan::New("Selector").ToLocalChecked(), GetFunction(tpl).ToLocalChecked());
+  }
+
+  const std::shared_ptr<const Selector>& Compiled() const { return selector; }
+
+private:
+  CypherSelector(const std::shared_ptr<const Selector>& selector): selector(selector) {}
+  ~CypherSelector() {}
+
+  static NAN_METHOD(New) {
+    if (!info.IsConstructCall()) {
+      ThrowError("Selector must be called with new.");
+      return;
+    }
+
+    if (!info[0]->IsString()) {
+      ThrowError("Parameter selector must be a string.");
+      return;
+    }
+
+    std::string error;
+    auto selector = Selector::Compile(*Utf8String(info[0]), error);
+    if (!selector) {
+      ThrowError(error.c_str());
+      return;
+    }
+
+    auto wrapper = new CypherSelector(selector);
+    wrapper->Wrap(info.This());
+    Nan::Set(info.This(), Nan::New("selector").ToLocalChecked(), info[0]);
+    info.GetReturnValue().Set(info.This());
+  }
+
+  std::shared_ptr<const Selector> selector;
+};
+
+bool GetSelectorsParam(const AddonData& addon, const char* name, Local<Object>& object,
+                       std::vector<std::shared_ptr<const Selector>>& selectors) {
+  std::string msg = "Property ";
+  msg += name;
+  msg += " must be an array of selectors made by compileSelector.";
+
+  auto key = Nan::New(name).ToLocalChecked();
+  auto val = object->Get(Nan::GetCurrentContext(), key).ToLocalChecked();
+  if (!val->IsArray()) {
+    ThrowError(msg.c_str());
+    return false;
+  }
+
+  auto selectorTemplate = Local<FunctionTemplate>::New(Isolate::GetCurrent(), addon.selectorTemplate);
+  auto array = val.As<Array>();
+  for (unsigned int i = 0; i < array->Length(); i++) {
+    auto item = Nan::Get(array, i).ToLocalChecked();
+    if (!selectorTemplate->HasInstance(item)) {
+      ThrowError(msg.c_str());
+      return false;
+    }
+    selectors.push_back(ObjectWrap::Unwrap<CypherSelector>(item.As<Object>())->Compiled());
+  }
+  return true;
+}
+
+// Reads a list of operations, each an object with its type and the members of that type.
+bool GetRewriteOperations(const AddonData& addon, const char* name, Local<Object>& object,
+                          std::vector<RewriteOperation>& operations) {
+  std::string msg = "Property ";
+  msg += name;
+  msg += " must be an array of add-predicate operations with a predicate, add-label operations with a label,";
+  msg += " or rename operations with from and to, each with an optional selector made by compileSelector.";
+
+  auto key = Nan::New(name).ToLocalChecked();
+  auto val = object->Get(Nan::GetCurrentContext(), key).ToLocalChecked();
+  if (!val->IsArray()) {
+    ThrowError(msg.c_str());
+    return false;
+  }
+
+  auto selectorTemplate = Local<FunctionTemplate>::New(Isolate::GetCurrent(), addon.selectorTemplate);
+  auto array = val.As<Array>();
+  for (unsigned int i = 0; i < array->Length(); i++) {
+    auto item = Nan::Get(array, i).ToLocalChecked();
+    if (!item->IsObject()) {
+      ThrowError(msg.c_str());
+      return false;
+    }
+
+    auto entry = item->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
+    Local<Value> none;
+    auto type = GetOptionalStringParam("type", entry, none);
+    std::string typeName = type.IsEmpty() ? "" : *Utf8String(type);
+    RewriteOperation operation;
+    Local<Value> text, from;
+    if (typeName == "add-predicate") {
+      operation.type = RewriteOperation::Type::AddPredicate;
+      text = GetOptionalStringParam("predicate", entry, none);
+    }
+    else if (typeName == "add-label") {
+      operation.type = RewriteOperation::Type::AddLabel;
+      text = GetOptionalStringParam("label", entry, none);
+    }
+    else if (typeName == "rename") {
+      operation.type = RewriteOperation::Type::Rename;
+      text = GetOptionalStringParam("to", entry, none);
+      from = GetOptionalStringParam("from", entry, none);
+      if (from.IsEmpty())
+        text = none;
+    }
+    if (text.IsEmpty()) {
+      ThrowError(msg.c_str());
+      return false;
+    }
+    operation.text = *Utf8String(text);
+    if (!from.IsEmpty())
+      operation.name = *Utf8String(from);
+
+    // An undefined selector is the same as none.
+    auto selector = entry->Get(Nan::GetCurrentContext(), Nan::New("selector").ToLocalChecked()).ToLocalChecked();
+    if (!selector->IsUndefined()) {
+      if (!selectorTemplate->HasInstance(selector)) {
+        ThrowError(msg.c_str());
+        return false;
+      }
+      operation.selector = ObjectWrap::Unwrap<CypherSelector>(selector.As<Object>())->Compiled();
+    }
+    operations.push_back(operation);
+  }
+  return true;
+}
+
+void GetParseOptions(const AddonData& addon, Local<Object>& object, ParseOptions& options, OutputFormat& format) {
+  options.width = GetOptionalUIntParam("width", object, options.width);
+  options.dumpAst = GetOptionalBoolParam("dumpAst", object, options.dumpAst);
+  if (GetOptionalBoolParam("rawJson", object, false))
+    format = OutputFormat::Json;
+  format = GetOptionalFormatParam("format", object, format);
+  options.colorize = GetOptionalBoolParam("colorize", object, options.colorize);
+  options.parseOnlyStatements = GetOptionalBoolParam("parseOnlyStatements", object, options.parseOnlyStatements);
+  options.threads = GetOptionalUIntParam("threads", object, options.threads);
+  options.position = GetOptionalPositionParam("position", object, options.position);
+  options.ranges = GetOptionalBoolParam("ranges", object, options.ranges);
+  options.fixedShapes = GetOptionalBoolParam("fixedShapes", object, options.fixedShapes);
+  options.compact = GetOptionalBoolParam("compact", object, options.compact);
+  options.lint = GetOptionalLintParam("lint", object, options.lint);
+  options.schema = GetOptionalSchemaParam(addon, "schema", object, options.schema);
+  options.scopes = GetOptionalBoolParam("scopes", object, options.scopes);
+  options.normalize = GetOptionalBoolParam("normalize", object, options.normalize);
+}
+
+AddonData& GetAddonData(const Nan::FunctionCallbackInfo<Value>& info) {
+  return *static_cast<AddonData*>(info.Data().As<External>()->Value());
+}
+
+Local<Object> GetMetrics(const KeyTable& keys, const ParserMetrics& metrics) {
+  auto result = Nan::New<Object>();
+  Nan::Set(result, keys.Get("parses"), Nan::New<Number>((double)metrics.parses));
+  Nan::Set(result, keys.Get("cacheHits"), Nan::New<Number>((double)metrics.cacheHits));
+  Nan::Set(result, keys.Get("failures"), Nan::New<Number>((double)metrics.failures));
+  Nan::Set(result, keys.Get("rejected"), Nan::New<Number>((double)metrics.rejected));
+  Nan::Set(result, keys.Get("bytes"), Nan::New<Number>((double)metrics.bytes));
+  Nan::Set(result, keys.Get("parseTime"), Nan::New<Number>(metrics.nanoseconds / 1e6));
+  return result;
+}
 
 NAN_METHOD(Parse) {
   Nan::HandleScope scope; 
   Local<Value> query;
-  unsigned int width = 0;
-  bool dumpAst = false;
-  bool rawJson = false;
-  bool colorize = false;
-  bool parseOnlyStatements = true;
+  ParseOptions options;
+  OutputFormat format = OutputFormat::Object;
 
   if (info.Length() < 2) {
     ThrowError("Missing parameters.");
@@ -123,10 +752,83 @@ NAN_METHOD(Parse) {
   else if (info[0]->IsObject()) {
     auto object = info[1]->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
     query = GetOptionalStringParam("query", object, query);
-    width = GetOptionalUIntParam("width", object, width);
-    dumpAst = GetOptionalBoolParam("dumpAst", object, dumpAst);
-    rawJson = GetOptionalBoolParam("rawJson", object, rawJson);
-    colorize = GetOptionalBoolParam("colorize", object, colorize);
+    GetParseOptions(GetAddonData(info), object, options, format);
+  }
+  else {
+    ThrowError("Parameter query must be an object or a string.");
+    return;
+  }
+
+  auto queryStr = query->ToString(Nan::GetCurrentContext()).ToLocalChecked();
+  Utf8String uftStr(queryStr);
+  // Offsets only need mapping to utf-16 when the query is not plain ascii.
+  options.utf16 = uftStr.length() != queryStr->Length();
+  Callback *callback = new Callback(info[0].As<Function>());
+  auto& addon = GetAddonData(info);
+  AsyncQueueWorker(new CypherParserWorker(addon.keys, &addon.metrics, *uftStr, options, format, callback));
+}
+
+NAN_METHOD(ParseFile) {
+  Nan::HandleScope scope;
+  Local<Value> path;
+  ParseOptions options;
+  OutputFormat format = OutputFormat::Object;
+
+  if (info.Length() < 2) {
+    ThrowError("Missing parameters.");
+    return;
+  }
+
+  if (!info[0]->IsFunction()) {
+    ThrowError("Parameter callback must be a function.");
+    return;
+  }
+
+  if (info[1]->IsString()) {
+    path = info[1];
+  }
+  else if (info[1]->IsObject()) {
+    auto object = info[1]->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
+    path = GetOptionalStringParam("path", object, path);
+    GetParseOptions(GetAddonData(info), object, options, format);
+  }
+  else {
+    ThrowError("Parameter path must be an object or a string.");
+    return;
+  }
+
+  if (path.IsEmpty()) {
+    ThrowError("Missing path.");
+    return;
+  }
+
+  Utf8String pathStr(path);
+  options.utf16 = true;
+  Callback *callback = new Callback(info[0].As<Function>());
+  AsyncQueueWorker(new CypherFileParserWorker(GetAddonData(info).keys, *pathStr, options, format, callback));
+}
+
+NAN_METHOD(Split) {
+  Nan::HandleScope scope;
+  Local<Value> query;
+  bool parseOnlyStatements = true;
+
+  if (info.Length() < 2) {
+    ThrowError("Missing parameters.");
+    return;
+  }
+
+  if (!info[0]->IsFunction()) {
+    ThrowError("Parameter callback must be a function.");
+    return;
+  }
+
+  if (info[1]->IsString()) {
+    query = info[1];
+  }
+  else if (info[1]->IsObject()) {
+    auto object = info[1]->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
+    query = GetOptionalStringParam("query", object, query);
     parseOnlyStatements = GetOptionalBoolParam("parseOnlyStatements", object, parseOnlyStatements);
   }
   else {
@@ -136,13 +838,610 @@ NAN_METHOD(Parse) {
 
   Utf8String uftStr(query->ToString(Nan::GetCurrentContext()).ToLocalChecked());
   Callback *callback = new Callback(info[0].As<Function>());
-  AsyncQueueWorker(new CypherParserWorker(*uftStr, width, dumpAst, rawJson, colorize, parseOnlyStatements, callback));
+  AsyncQueueWorker(new CypherSplitWorker(GetAddonData(info).keys, *uftStr, parseOnlyStatements, callback));
 }
 
-NAN_MODULE_INIT(InitAll) {
-  Export(target, "parse", Parse);
+// Analyses call back with whether the query had no errors and their result, or with the
+// error when the query could not be parsed at all.
+class CypherAnalysisWorker : public AsyncWorker {
+public:
+  CypherAnalysisWorker(Callback *callback) : AsyncWorker(callback) {}
+
+  void HandleErrorCallback () {
+    Nan::HandleScope scope;
+    Call(false, Nan::Error(ErrorMessage()));
+  }
+
+protected:
+  void Call(bool succeeded, Local<Value> result) {
+    Local<Value> argv[] = {
+      New(succeeded),
+      result
+    };
+    AsyncResource resource("cypher-parser-callback");
+    resource.runInAsyncScope(GetCurrentContext()->Global(), **callback, 2, argv);
+  }
+};
+
+class CypherSummaryWorker : public CypherAnalysisWorker {
+public:
+  CypherSummaryWorker(const KeyTable& keys, const string& query, const ParseOptions& options, Callback *callback)
+  : CypherAnalysisWorker(callback), keys(keys), query(query), options(options) {}
+
+  ~CypherSummaryWorker() {}
+
+  void Execute () {
+    if (!Summarize(summary, query.c_str(), query.length(), options))
+      SetErrorMessage("Could not parse query.");
+  }
+
+  void HandleOKCallback () {
+    Nan::HandleScope scope;
+    auto result = New<Object>();
+    Nan::Set(result, keys.Get("labels"), GetSorted(summary.labels));
+    Nan::Set(result, keys.Get("relTypes"), GetSorted(summary.relTypes));
+    Nan::Set(result, keys.Get("propertyKeys"), GetSorted(summary.propertyKeys));
+    Nan::Set(result, keys.Get("procedures"), GetSorted(summary.procedures));
+    Nan::Set(result, keys.Get("parameters"), GetSorted(summary.parameters));
+    Nan::Set(result, keys.Get("errors"), New(summary.nErrors));
+
+    Call(summary.nErrors == 0, result);
+  }
+
+private:
+  // Names are collected in hash sets, and only sorted once here for stable output.
+  Local<Array> GetSorted(const unordered_set<string>& names) {
+    vector<const string*> sorted;
+    for (auto& name : names)
+      sorted.push_back(&name);
+    sort(sorted.begin(), sorted.end(), [](const string* a, const string* b) { return *a < *b; });
+
+    auto result = New<Array>((int)sorted.size());
+    for (size_t i = 0; i < sorted.size(); i++)
+      Nan::Set(result, i, keys.Get(sorted[i]->c_str(), sorted[i]->length()));
+    return result;
+  }
+
+  const KeyTable& keys;
+  string query;
+  ParseOptions options;
+  QuerySummary summary;
+};
+
+class CypherClassifyWorker : public CypherAnalysisWorker {
+public:
+  CypherClassifyWorker(const KeyTable& keys, const string& query, const ParseOptions& options, Callback *callback)
+  : CypherAnalysisWorker(callback), keys(keys), query(query), options(options) {}
+
+  ~CypherClassifyWorker() {}
+
+  void Execute () {
+    if (!Classify(kind, nErrors, query.c_str(), query.length(), options))
+      SetErrorMessage("Could not parse query.");
+  }
+
+  void HandleOKCallback () {
+    Nan::HandleScope scope;
+    auto result = New<Object>();
+    Nan::Set(result, keys.Get("kind"), keys.Get(QueryKindName(kind)));
+    Nan::Set(result, keys.Get("errors"), New(nErrors));
+
+    Call(nErrors == 0, result);
+  }
+
+private:
+  const KeyTable& keys;
+  string query;
+  ParseOptions options;
+  QueryKind kind = QueryKind::Read;
+  unsigned int nErrors = 0;
+};
+
+class CypherRewriteWorker : public CypherAnalysisWorker {
+public:
+  CypherRewriteWorker(const KeyTable& keys, const string& query, const ParseOptions& options,
+                      const vector<RewriteOperation>& operations, Callback *callback)
+  : CypherAnalysisWorker(callback), keys(keys), query(query), options(options), operations(operations) {}
+
+  ~CypherRewriteWorker() {}
+
+  void Execute () {
+    if (!Rewrite(rewrite, query.c_str(), query.length(), options, operations))
+      SetErrorMessage("Could not parse query.");
+  }
+
+  void HandleOKCallback () {
+    Nan::HandleScope scope;
+    auto result = New<Object>();
+    Nan::Set(result, keys.Get("query"), New(rewrite.query).ToLocalChecked());
+    Nan::Set(result, keys.Get("edits"), New(rewrite.edits));
+    Nan::Set(result, keys.Get("errors"), New(rewrite.nErrors));
+
+    Call(rewrite.nErrors == 0, result);
+  }
+
+private:
+  const KeyTable& keys;
+  string query;
+  ParseOptions options;
+  vector<RewriteOperation> operations;
+  RewriteResult rewrite;
+};
+
+class CypherCostWorker : public CypherAnalysisWorker {
+public:
+  CypherCostWorker(const KeyTable& keys, const string& query, const ParseOptions& options, const CostWeights& weights, Callback *callback)
+  : CypherAnalysisWorker(callback), keys(keys), query(query), options(options), weights(weights) {}
+
+  ~CypherCostWorker() {}
+
+  void Execute () {
+    if (!EstimateCost(cost, query.c_str(), query.length(), options, weights))
+      SetErrorMessage("Could not parse query.");
+  }
+
+  void HandleOKCallback () {
+    Nan::HandleScope scope;
+    auto factors = New<Array>();
+    for (auto factor : { &cost.unboundedRange, &cost.rangeHops, &cost.cartesianProducts, &cost.unwindElements }) {
+      if (!factor->count)
+        continue;
+      auto item = New<Object>();
+      Nan::Set(item, keys.Get("name"), keys.Get(factor->name));
+      Nan::Set(item, keys.Get("count"), New(factor->count));
+      Nan::Set(item, keys.Get("score"), New(factor->score));
+      Nan::Set(factors, factors->Length(), item);
+    }
+
+    auto result = New<Object>();
+    Nan::Set(result, keys.Get("score"), New(cost.score));
+    Nan::Set(result, keys.Get("factors"), factors);
+    Nan::Set(result, keys.Get("errors"), New(cost.nErrors));
+
+    Call(cost.nErrors == 0, result);
+  }
+
+private:
+  const KeyTable& keys;
+  string query;
+  ParseOptions options;
+  CostWeights weights;
+  QueryCost cost;
+};
+
+// Analyses take a query string or an object with the query and parseOnlyStatements, as split does.
+static bool GetAnalysisParams(const Nan::FunctionCallbackInfo<Value>& info, string& query, ParseOptions& options) {
+  Local<Value> value;
+
+  if (info.Length() < 2) {
+    ThrowError("Missing parameters.");
+    return false;
+  }
+
+  if (!info[0]->IsFunction()) {
+    ThrowError("Parameter callback must be a function.");
+    return false;
+  }
+
+  if (info[1]->IsString()) {
+    value = info[1];
+  }
+  else if (info[1]->IsObject()) {
+    auto object = info[1]->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
+    value = GetOptionalStringParam("query", object, value);
+    options.parseOnlyStatements = GetOptionalBoolParam("parseOnlyStatements", object, options.parseOnlyStatements);
+  }
+  else {
+    ThrowError("Parameter query must be an object or a string.");
+    return false;
+  }
+
+  Utf8String uftStr(value->ToString(Nan::GetCurrentContext()).ToLocalChecked());
+  query = *uftStr;
+  return true;
 }
 
+NAN_METHOD(Summarize) {
+  Nan::HandleScope scope;
+  string query;
+  ParseOptions options;
+  if (!GetAnalysisParams(info, query, options))
+    return;
+
+  Callback *callback = new Callback(info[0].As<Function>());
+  AsyncQueueWorker(new CypherSummaryWorker(GetAddonData(info).keys, query, options, callback));
+}
+
+NAN_METHOD(EstimateCost) {
+  Nan::HandleScope scope;
+  string query;
+  ParseOptions options;
+  CostWeights weights;
+  if (!GetAnalysisParams(info, query, options))
+    return;
+
+  if (info[1]->IsObject() && !info[1]->IsString()) {
+    auto object = info[1]->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
+    weights = GetOptionalWeightsParam("weights", object, weights);
+  }
+
+  Callback *callback = new Callback(info[0].As<Function>());
+  AsyncQueueWorker(new CypherCostWorker(GetAddonData(info).keys, query, options, weights, callback));
+}
+
+NAN_METHOD(Rewrite) {
+  Nan::HandleScope scope;
+  string query;
+  ParseOptions options;
+  vector<RewriteOperation> operations;
+  if (!GetAnalysisParams(info, query, options))
+    return;
+
+  if (!info[1]->IsObject() || info[1]->IsString()) {
+    ThrowError("Parameter query must be an object with operations.");
+    return;
+  }
+  auto object = info[1]->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
+  if (!GetRewriteOperations(GetAddonData(info), "operations", object, operations))
+    return;
+
+  Callback *callback = new Callback(info[0].As<Function>());
+  AsyncQueueWorker(new CypherRewriteWorker(GetAddonData(info).keys, query, options, operations, callback));
+}
+
+NAN_METHOD(Classify) {
+  Nan::HandleScope scope;
+  string query;
+  ParseOptions options;
+  if (!GetAnalysisParams(info, query, options))
+    return;
+
+  Callback *callback = new Callback(info[0].As<Function>());
+  AsyncQueueWorker(new CypherClassifyWorker(GetAddonData(info).keys, query, options, callback));
+}
+
+// Reads the query and options of walks writing only parts of the AST.
+bool GetWalkParams(const Nan::FunctionCallbackInfo<Value>& info, Local<Object>& object, string& query, ParseOptions& options) {
+  if (info.Length() < 2) {
+    ThrowError("Missing parameters.");
+    return false;
+  }
+
+  if (!info[0]->IsFunction()) {
+    ThrowError("Parameter callback must be a function.");
+    return false;
+  }
+
+  if (!info[1]->IsObject()) {
+    ThrowError("Parameter query must be an object.");
+    return false;
+  }
+
+  object = info[1]->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
+  Local<Value> value;
+  value = GetOptionalStringParam("query", object, value);
+  if (value.IsEmpty()) {
+    ThrowError("Missing query.");
+    return false;
+  }
+
+  options.parseOnlyStatements = GetOptionalBoolParam("parseOnlyStatements", object, options.parseOnlyStatements);
+  options.position = GetOptionalPositionParam("position", object, options.position);
+  options.ranges = GetOptionalBoolParam("ranges", object, options.ranges);
+  options.fixedShapes = GetOptionalBoolParam("fixedShapes", object, options.fixedShapes);
+  options.compact = GetOptionalBoolParam("compact", object, options.compact);
+
+  auto queryStr = value->ToString(Nan::GetCurrentContext()).ToLocalChecked();
+  Utf8String uftStr(queryStr);
+  options.utf16 = uftStr.length() != queryStr->Length();
+  query = *uftStr;
+  return true;
+}
+
+NAN_METHOD(Visit) {
+  Nan::HandleScope scope;
+  Local<Object> object;
+  string query;
+  ParseOptions options;
+  NodeTypeSet types;
+  if (!GetWalkParams(info, object, query, options) || !GetTypesParam("types", object, types))
+    return;
+
+  Callback *callback = new Callback(info[0].As<Function>());
+  AsyncQueueWorker(new CypherVisitWorker(GetAddonData(info).keys, query, options, types, callback));
+}
+
+NAN_METHOD(Select) {
+  Nan::HandleScope scope;
+  Local<Object> object;
+  string query;
+  ParseOptions options;
+  vector<shared_ptr<const Selector>> selectors;
+  if (!GetWalkParams(info, object, query, options) || !GetSelectorsParam(GetAddonData(info), "selectors", object, selectors))
+    return;
+
+  Callback *callback = new Callback(info[0].As<Function>());
+  AsyncQueueWorker(new CypherSelectWorker(GetAddonData(info).keys, query, options, selectors, callback));
+}
+
+class CypherDocumentWorker : public AsyncWorker {
+public:
+  CypherDocumentWorker(const KeyTable& keys, ScriptDocument& document, size_t start, size_t end, const string& text, Callback *callback)
+  : AsyncWorker(callback), keys(keys), document(document), start(start), end(end), text(text) {}
+
+  ~CypherDocumentWorker() {}
+
+  void Execute () {
+    succeeded = document.Edit(start, end, text, delta);
+  }
+
+  void HandleOKCallback () {
+    Nan::HandleScope scope;
+    auto context = GetCurrentContext();
+    auto segments = New<Array>(delta.segments.size());
+    for (size_t i = 0; i < delta.segments.size(); i++) {
+      auto& segment = delta.segments[i];
+      auto position = New<Object>();
+      Nan::Set(position, keys.Get("line"), New<Number>(segment.position.line));
+      Nan::Set(position, keys.Get("column"), New<Number>(segment.position.column));
+      Nan::Set(position, keys.Get("offset"), New<Number>((double)segment.position.offset));
+
+      auto value = New<Object>();
+      Nan::Set(value, keys.Get("start"), New<Number>((double)segment.start));
+      Nan::Set(value, keys.Get("end"), New<Number>((double)segment.end));
+      Nan::Set(value, keys.Get("position"), position);
+      Nan::Set(value, keys.Get("type"), keys.Get(segment.command ? "command" : "statement"));
+      Nan::Set(value, keys.Get("result"), keys.Build(segment.result->document, document.Options().fixedShapes));
+      Nan::Set(segments, i, value);
+    }
+
+    auto result = New<Object>();
+    Nan::Set(result, keys.Get("index"), New<Number>((double)delta.index));
+    Nan::Set(result, keys.Get("deleteCount"), New<Number>((double)delta.deleteCount));
+    Nan::Set(result, keys.Get("segments"), segments);
+
+    Local<Value> argv[] = {
+      New(succeeded),
+      result
+    };
+    AsyncResource resource("cypher-parser-callback");
+    resource.runInAsyncScope(context->Global(), **callback, 2, argv);
+  }
+
+private:
+  const KeyTable& keys;
+  ScriptDocument& document;
+  size_t start;
+  size_t end;
+  string text;
+  DocumentDelta delta;
+  bool succeeded;
+};
+
+class CypherHandleWorker : public CypherParserWorker {
+public:
+  CypherHandleWorker(const KeyTable& keys, ParserHandle& handle, const string& query, bool utf16, OutputFormat format, Callback *callback)
+  : CypherParserWorker(keys, NULL, query, handle.Options(), format, callback), handle(handle), utf16(utf16) {}
+
+  ~CypherHandleWorker() {}
+
+  void Execute () {
+    string error;
+    succeeded = handle.Parse(tree, query, utf16, error);
+    if (!error.empty())
+      SetErrorMessage(error.c_str());
+    else
+      Serialize();
+  }
+
+private:
+  ParserHandle& handle;
+  bool utf16;
+};
+
+class CypherParserHandle : public ObjectWrap {
+public:
+  static void Init(Local<Object> target, Local<Value> data) {
+    auto tpl = Nan::New<FunctionTemplate>(New, data);
+    tpl->SetClassName(Nan::New("CypherParser").ToLocalChecked());
+    tpl->InstanceTemplate()->SetInternalFieldCount(1);
+    SetPrototypeMethod(tpl, "parse", Parse);
+    SetPrototypeMethod(tpl, "metrics", Metrics);
+    Nan::Set(target, Nan::New("CypherParser").ToLocalChecked(), GetFunction(tpl).ToLocalChecked());
+  }
+
+private:
+  CypherParserHandle(const KeyTable& keys, const ParseOptions& options, const ParserLimits& limits, OutputFormat format)
+  : keys(keys), handle(options, limits), format(format) {}
+  ~CypherParserHandle() {}
+
+  static NAN_METHOD(New) {
+    if (!info.IsConstructCall()) {
+      ThrowError("CypherParser must be called with new.");
+      return;
+    }
+
+    ParseOptions options;
+    ParserLimits limits;
+    OutputFormat format = OutputFormat::Object;
+    if (info[0]->IsObject()) {
+      auto object = info[0]->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
+      GetParseOptions(GetAddonData(info), object, options, format);
+      limits.maxQueryLength = GetOptionalUIntParam("maxQueryLength", object, (unsigned int)limits.maxQueryLength);
+      limits.cacheSize = GetOptionalUIntParam("cacheSize", object, (unsigned int)limits.cacheSize);
+    }
+
+    auto parser = new CypherParserHandle(GetAddonData(info).keys, options, limits, format);
+    parser->Wrap(info.This());
+    info.GetReturnValue().Set(info.This());
+  }
+
+  static NAN_METHOD(Parse) {
+    if (info.Length() < 2) {
+      ThrowError("Missing parameters.");
+      return;
+    }
+
+    if (!info[0]->IsFunction()) {
+      ThrowError("Parameter callback must be a function.");
+      return;
+    }
+
+    if (!info[1]->IsString()) {
+      ThrowError("Parameter query must be a string.");
+      return;
+    }
+
+    auto parser = ObjectWrap::Unwrap<CypherParserHandle>(info.This());
+    auto queryStr = info[1].As<String>();
+    Utf8String uftStr(queryStr);
+    Callback *callback = new Callback(info[0].As<Function>());
+
+    auto worker = new CypherHandleWorker(parser->keys, parser->handle, *uftStr, uftStr.length() != queryStr->Length(), parser->format, callback);
+    // Keeps the parser alive until the parse completes.
+    worker->SaveToPersistent("parser", info.This());
+    AsyncQueueWorker(worker);
+  }
+
+  static NAN_METHOD(Metrics) {
+    auto parser = ObjectWrap::Unwrap<CypherParserHandle>(info.This());
+    auto& metrics = parser->handle.Metrics();
+
+    info.GetReturnValue().Set(GetMetrics(parser->keys, metrics));
+  }
+
+  const KeyTable& keys;
+  ParserHandle handle;
+  OutputFormat format;
+};
+
+class CypherDocument : public ObjectWrap {
+public:
+  static void Init(Local<Object> target, Local<Value> data) {
+    auto tpl = Nan::New<FunctionTemplate>(New, data);
+    tpl->SetClassName(Nan::New("Document").ToLocalChecked());
+    tpl->InstanceTemplate()->SetInternalFieldCount(1);
+    SetPrototypeMethod(tpl, "edit", Edit);
+    Nan::Set(target, Nan::New("Document").ToLocalChecked(), GetFunction(tpl).ToLocalChecked());
+  }
+
+private:
+  CypherDocument(const KeyTable& keys, const ParseOptions& options): keys(keys), document(options) {}
+  ~CypherDocument() {}
+
+  static NAN_METHOD(New) {
+    if (!info.IsConstructCall()) {
+      ThrowError("Document must be called with new.");
+      return;
+    }
+
+    ParseOptions options;
+    OutputFormat format = OutputFormat::Object;
+    if (info[0]->IsObject()) {
+      auto object = info[0]->ToObject(Nan::GetCurrentContext()).ToLocalChecked();
+      GetParseOptions(GetAddonData(info), object, options, format);
+    }
+
+    auto document = new CypherDocument(GetAddonData(info).keys, options);
+    document->Wrap(info.This());
+    info.GetReturnValue().Set(info.This());
+  }
+
+  static NAN_METHOD(Edit) {
+    if (info.Length() < 4) {
+      ThrowError("Missing parameters.");
+      return;
+    }
+
+    if (!info[0]->IsFunction()) {
+      ThrowError("Parameter callback must be a function.");
+      return;
+    }
+
+    if (!info[1]->IsNumber() || !info[2]->IsNumber() || !info[3]->IsString()) {
+      ThrowError("Parameters start and end must be numbers, and text a string.");
+      return;
+    }
+
+    auto document = ObjectWrap::Unwrap<CypherDocument>(info.This());
+    auto start = (size_t)info[1]->IntegerValue(Nan::GetCurrentContext()).FromJust();
+    auto end = (size_t)info[2]->IntegerValue(Nan::GetCurrentContext()).FromJust();
+    Utf8String uftStr(info[3]);
+    Callback *callback = new Callback(info[0].As<Function>());
+
+    auto worker = new CypherDocumentWorker(document->keys, document->document, start, end, *uftStr, callback);
+    // Keeps the document alive until the edit completes.
+    worker->SaveToPersistent("document", info.This());
+    AsyncQueueWorker(worker);
+  }
+
+  const KeyTable& keys;
+  ScriptDocument document;
+};
+
+// Names whose ids binary results use, in id order.
+Local<Array> GetNames(const KeyTable& keys) {
+  auto& names = keys.Names();
+  auto result = New<Array>(names.Size());
+  for (size_t id = 0; id < names.Size(); id++)
+    Nan::Set(result, id, keys.Get(names.Name((int)id), names.Length((int)id)));
+  return result;
+}
+
+// Full names of the keys, types and operators of compact results.
+Local<Object> GetDictionary(const KeyTable& keys) {
+  auto& names = NodeBin::Names();
+  auto& compactKeys = NodeBin::CompactKeys();
+  auto dictionaryKeys = New<Object>();
+  auto values = New<Array>((int)names.size());
+  for (size_t id = 0; id < names.size(); id++) {
+    Nan::Set(dictionaryKeys, keys.Get(compactKeys[id].c_str(), compactKeys[id].length()), keys.Get(names[id]));
+    Nan::Set(values, id, keys.Get(names[id]));
+  }
+
+  auto result = New<Object>();
+  Nan::Set(result, New("keys").ToLocalChecked(), dictionaryKeys);
+  Nan::Set(result, New("values").ToLocalChecked(), values);
+  return result;
+}
+
+NAN_METHOD(Metrics) {
+  auto& addon = GetAddonData(info);
+  info.GetReturnValue().Set(GetMetrics(addon.keys, addon.metrics));
+}
+
+void Export(Local<Object> target, const char* name, Nan::FunctionCallback method, Local<Value> data) {
+  auto function = GetFunction(Nan::New<FunctionTemplate>(method, data)).ToLocalChecked();
+  Nan::Set(target, Nan::New(name).ToLocalChecked(), function);
+}
+
+void DeleteAddonData(void* addon) {
+  delete static_cast<AddonData*>(addon);
+}
+
+// The module is context aware: each environment loading it, as a worker thread does, runs
+// this again and gets its own interned keys, metrics and constructors, which reach every
+// method as its data.
 NODE_MODULE_INIT() {
-  InitAll(exports);
+  auto isolate = context->GetIsolate();
+  auto addon = new AddonData(isolate);
+  node::AddEnvironmentCleanupHook(isolate, DeleteAddonData, addon);
+
+  auto data = Nan::New<External>(addon);
+  Export(exports, "parse", Parse, data);
+  Export(exports, "parseFile", ParseFile, data);
+  Export(exports, "split", Split, data);
+  Export(exports, "summarize", Summarize, data);
+  Export(exports, "classify", Classify, data);
+  Export(exports, "estimateCost", EstimateCost, data);
+  Export(exports, "visit", Visit, data);
+  Export(exports, "select", Select, data);
+  Export(exports, "rewrite", Rewrite, data);
+  Export(exports, "metrics", Metrics, data);
+  Nan::Set(exports, Nan::New("names").ToLocalChecked(), GetNames(addon->keys));
+  Nan::Set(exports, Nan::New("dictionary").ToLocalChecked(), GetDictionary(addon->keys));
+  CypherDocument::Init(exports, data);
+  CypherParserHandle::Init(exports, data);
+  CypherSchema::Init(exports, data, *addon);
+  CypherSelector::Init(exports, data, *addon);
 }
@@ -0,0 +1,106 @@
+#include "cbor.hpp"
+#include <cstring>
+
+enum CborMajor : unsigned char {
+  Unsigned = 0,
+  Negative = 1,
+  Text = 3,
+  Array = 4,
+  Map = 5
+};
+
+static const unsigned char cborFalse = 0xf4;
+static const unsigned char cborTrue = 0xf5;
+static const unsigned char cborNull = 0xf6;
+static const unsigned char cborDouble = 0xfb;
+static const unsigned char cborIndefinite = 31;
+static const unsigned char cborBreak = 0xff;
+
+// Type and argument of an item, with the argument in its shortest big endian form.
+void CborWriter::Head(unsigned char major, uint64_t value) {
+  major <<= 5;
+  if (value < 24) {
+    output += (char)(major | value);
+    return;
+  }
+
+  int size = value <= 0xff ? 1 : value <= 0xffff ? 2 : value <= 0xffffffff ? 4 : 8;
+  output += (char)(major | (size == 1 ? 24 : size == 2 ? 25 : size == 4 ? 26 : 27));
+  for (int i = size - 1; i >= 0; i--)
+    output += (char)(value >> (i * 8));
+}
+
+bool CborWriter::Null() {
+  output += (char)cborNull;
+  return true;
+}
+
+bool CborWriter::Bool(bool b) {
+  output += (char)(b ? cborTrue : cborFalse);
+  return true;
+}
+
+bool CborWriter::Int(int i) {
+  return Int64(i);
+}
+
+bool CborWriter::Uint(unsigned u) {
+  return Uint64(u);
+}
+
+bool CborWriter::Int64(int64_t i) {
+  if (i < 0)
+    Head(Negative, (uint64_t)(-(i + 1)));
+  else
+    Head(Unsigned, (uint64_t)i);
+  return true;
+}
+
+bool CborWriter::Uint64(uint64_t u) {
+  Head(Unsigned, u);
+  return true;
+}
+
+bool CborWriter::Double(double d) {
+  uint64_t bits;
+  memcpy(&bits, &d, sizeof(bits));
+  output += (char)cborDouble;
+  for (int i = 7; i >= 0; i--)
+    output += (char)(bits >> (i * 8));
+  return true;
+}
+
+// Results hold no raw numbers, they are only written as text for completeness of the handler.
+bool CborWriter::RawNumber(const char* str, rapidjson::SizeType length, bool copy) {
+  return String(str, length, copy);
+}
+
+bool CborWriter::String(const char* str, rapidjson::SizeType length, bool) {
+  Head(Text, length);
+  output.append(str, length);
+  return true;
+}
+
+bool CborWriter::StartObject() {
+  output += (char)(Map << 5 | cborIndefinite);
+  return true;
+}
+
+bool CborWriter::Key(const char* str, rapidjson::SizeType length, bool copy) {
+  return String(str, length, copy);
+}
+
+bool CborWriter::EndObject(rapidjson::SizeType) {
+  output += (char)cborBreak;
+  return true;
+}
+
+bool CborWriter::StartArray() {
+  output += (char)(Array << 5 | cborIndefinite);
+  return true;
+}
+
+bool CborWriter::EndArray(rapidjson::SizeType) {
+  output += (char)cborBreak;
+  return true;
+}
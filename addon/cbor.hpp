@@ -0,0 +1,35 @@
+#ifndef __CBOR_HPP__
+#define __CBOR_HPP__
+
+#include <cstdint>
+#include <string>
+#include "sink.hpp"
+
+// Encodes a result as CBOR (RFC 8949). Maps and arrays are written with indefinite lengths,
+// so the walk streams into the output without knowing member counts up front.
+class CborWriter : public ResultSink {
+public:
+  explicit CborWriter(std::string& output): output(output) {}
+
+  bool Null();
+  bool Bool(bool b);
+  bool Int(int i);
+  bool Uint(unsigned u);
+  bool Int64(int64_t i);
+  bool Uint64(uint64_t u);
+  bool Double(double d);
+  bool RawNumber(const char* str, rapidjson::SizeType length, bool copy);
+  bool String(const char* str, rapidjson::SizeType length, bool copy);
+  bool StartObject();
+  bool Key(const char* str, rapidjson::SizeType length, bool copy);
+  bool EndObject(rapidjson::SizeType memberCount);
+  bool StartArray();
+  bool EndArray(rapidjson::SizeType elementCount);
+
+private:
+  void Head(unsigned char major, uint64_t value);
+
+  std::string& output;
+};
+
+#endif //__CBOR_HPP__
@@ -0,0 +1,53 @@
+#include "classify.hpp"
+#include "ast.hpp"
+
+static bool IsSchemaCommand(cypher_astnode_type_t type) {
+  return type == CYPHER_AST_CREATE_NODE_PROP_INDEX
+    || type == CYPHER_AST_DROP_NODE_PROP_INDEX
+    || type == CYPHER_AST_CREATE_NODE_PROP_CONSTRAINT
+    || type == CYPHER_AST_DROP_NODE_PROP_CONSTRAINT
+    || type == CYPHER_AST_CREATE_REL_PROP_CONSTRAINT
+    || type == CYPHER_AST_DROP_REL_PROP_CONSTRAINT;
+}
+
+// FOREACH bodies only hold updating clauses, which are found as its children.
+static bool IsWriteClause(cypher_astnode_type_t type) {
+  return type == CYPHER_AST_CREATE
+    || type == CYPHER_AST_MERGE
+    || type == CYPHER_AST_SET
+    || type == CYPHER_AST_DELETE
+    || type == CYPHER_AST_REMOVE;
+}
+
+const char* QueryKindName(QueryKind kind) {
+  switch (kind) {
+  case QueryKind::Write:
+    return "write";
+  case QueryKind::Schema:
+    return "schema";
+  case QueryKind::Procedure:
+    return "procedure";
+  default:
+    return "read";
+  }
+}
+
+bool Classify(QueryKind& kind, unsigned int& nErrors, const char* query, size_t length, const ParseOptions& options) {
+  ParsedQuery parsed(query, length, options);
+  if (!parsed.Parsed())
+    return false;
+
+  nErrors = parsed.Errors();
+  kind = QueryKind::Read;
+  parsed.ForEachNode([&](const cypher_astnode_t* node) {
+    auto type = cypher_astnode_type(node);
+    if (IsSchemaCommand(type))
+      kind = QueryKind::Schema;
+    else if (IsWriteClause(type))
+      kind = QueryKind::Write;
+    else if (type == CYPHER_AST_CALL)
+      kind = QueryKind::Procedure;
+    return kind == QueryKind::Read || kind == QueryKind::Procedure;
+  });
+  return true;
+}
@@ -0,0 +1,21 @@
+#ifndef __CLASSIFY_HPP__
+#define __CLASSIFY_HPP__
+
+#include <cstddef>
+#include "parser.hpp"
+
+// Kind of work a query does, as a router picks a read replica or the leader for it.
+enum class QueryKind {
+  Read,
+  Write,
+  Schema,
+  Procedure
+};
+
+const char* QueryKindName(QueryKind kind);
+
+// Walks the AST only until a write clause or a schema command decides the kind, without
+// building a result tree. Procedure calls in queries that do not write are their own kind.
+bool Classify(QueryKind& kind, unsigned int& nErrors, const char* query, size_t length, const ParseOptions& options);
+
+#endif //__CLASSIFY_HPP__
@@ -0,0 +1,138 @@
+#include "cost.hpp"
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <strings.h>
+#include <vector>
+#include "ast.hpp"
+
+static bool GetInteger(const cypher_astnode_t* node, long long& value) {
+  if (node == NULL || cypher_astnode_type(node) != CYPHER_AST_INTEGER)
+    return false;
+
+  auto str = cypher_ast_integer_get_valuestr(node);
+  if (str == NULL)
+    return false;
+
+  char* end;
+  errno = 0;
+  value = strtoll(str, &end, 0);
+  return end != str && errno != ERANGE;
+}
+
+static void Add(CostFactor& factor, double count, double weight) {
+  factor.count += count;
+  factor.score += count * weight;
+}
+
+static void ScoreRange(QueryCost& cost, const cypher_astnode_t* range, const CostWeights& weights) {
+  long long end;
+  if (!GetInteger(cypher_ast_range_get_end(range), end))
+    Add(cost.unboundedRange, 1, weights.unboundedRange);
+  else if (end > 0)
+    Add(cost.rangeHops, (double)end, weights.rangeHop);
+}
+
+// Number of elements an UNWIND expression expands to, when known from the query text.
+static double UnwindLength(const cypher_astnode_t* expression) {
+  auto type = cypher_astnode_type(expression);
+  if (type == CYPHER_AST_COLLECTION)
+    return cypher_ast_collection_length(expression);
+
+  if (type != CYPHER_AST_APPLY_OPERATOR || cypher_ast_apply_operator_narguments(expression) < 2)
+    return 0;
+  auto name = cypher_ast_function_name_get_value(cypher_ast_apply_operator_get_func_name(expression));
+  if (strcasecmp(name, "range"))
+    return 0;
+
+  long long start, end, step = 1;
+  if (!GetInteger(cypher_ast_apply_operator_get_argument(expression, 0), start)
+      || !GetInteger(cypher_ast_apply_operator_get_argument(expression, 1), end))
+    return 0;
+  if (cypher_ast_apply_operator_narguments(expression) > 2
+      && !GetInteger(cypher_ast_apply_operator_get_argument(expression, 2), step))
+    return 0;
+  if (step == 0)
+    return 0;
+  // Bounds come from the query, so they are subtracted in double where they cannot overflow.
+  auto length = floor(((double)end - (double)start) / (double)step) + 1;
+  return length > 0 ? length : 0;
+}
+
+static void CollectVariables(const cypher_astnode_t* path, std::vector<std::string>& variables) {
+  if (cypher_astnode_instanceof(path, CYPHER_AST_NAMED_PATH))
+    path = cypher_ast_named_path_get_path(path);
+  if (cypher_astnode_instanceof(path, CYPHER_AST_SHORTEST_PATH))
+    path = cypher_ast_shortest_path_get_path(path);
+
+  for (unsigned int i = 0; i < cypher_ast_pattern_path_nelements(path); i++) {
+    auto element = cypher_ast_pattern_path_get_element(path, i);
+    if (cypher_astnode_type(element) != CYPHER_AST_NODE_PATTERN)
+      continue;
+    auto identifier = cypher_ast_node_pattern_get_identifier(element);
+    if (identifier)
+      variables.push_back(cypher_ast_identifier_get_name(identifier));
+  }
+}
+
+// Paths of a pattern are joined when they share a node variable, every group of joined
+// paths past the first is a cartesian product.
+static unsigned int CountCartesianProducts(const cypher_astnode_t* pattern) {
+  auto npaths = cypher_ast_pattern_npaths(pattern);
+  if (npaths < 2)
+    return 0;
+
+  std::vector<std::vector<std::string>> variables(npaths);
+  std::vector<unsigned int> group(npaths);
+  for (unsigned int i = 0; i < npaths; i++) {
+    CollectVariables(cypher_ast_pattern_get_path(pattern, i), variables[i]);
+    group[i] = i;
+  }
+
+  auto find = [&](unsigned int i) {
+    while (group[i] != i)
+      i = group[i] = group[group[i]];
+    return i;
+  };
+  for (unsigned int i = 0; i < npaths; i++) {
+    for (unsigned int j = i + 1; j < npaths; j++) {
+      for (auto& variable : variables[i]) {
+        bool shared = false;
+        for (auto& other : variables[j])
+          shared = shared || variable == other;
+        if (shared) {
+          group[find(j)] = find(i);
+          break;
+        }
+      }
+    }
+  }
+
+  unsigned int groups = 0;
+  for (unsigned int i = 0; i < npaths; i++)
+    groups += find(i) == i;
+  return groups - 1;
+}
+
+bool EstimateCost(QueryCost& cost, const char* query, size_t length, const ParseOptions& options, const CostWeights& weights) {
+  ParsedQuery parsed(query, length, options);
+  if (!parsed.Parsed())
+    return false;
+
+  cost.nErrors = parsed.Errors();
+  parsed.ForEachNode([&](const cypher_astnode_t* node) {
+    auto type = cypher_astnode_type(node);
+    if (type == CYPHER_AST_RANGE)
+      ScoreRange(cost, node, weights);
+    else if (type == CYPHER_AST_MATCH)
+      Add(cost.cartesianProducts, CountCartesianProducts(cypher_ast_match_get_pattern(node)), weights.cartesianProduct);
+    else if (type == CYPHER_AST_UNWIND)
+      Add(cost.unwindElements, UnwindLength(cypher_ast_unwind_get_expression(node)), weights.unwindElement);
+    return true;
+  });
+
+  for (auto factor : { &cost.unboundedRange, &cost.rangeHops, &cost.cartesianProducts, &cost.unwindElements })
+    cost.score += factor->score;
+  return true;
+}
@@ -0,0 +1,38 @@
+#ifndef __COST_HPP__
+#define __COST_HPP__
+
+#include <cstddef>
+#include "parser.hpp"
+
+// Cost of each occurrence of a factor, in arbitrary units compared to an admission limit.
+struct CostWeights {
+  // Var-length relationship without an upper bound, as in ()-[*]->() or ()-[*2..]->().
+  double unboundedRange = 100;
+  // Each hop of the upper bound of a bounded var-length relationship.
+  double rangeHop = 1;
+  // Each pattern path of a MATCH sharing no node variable with its other paths.
+  double cartesianProduct = 50;
+  // Each element of an UNWIND literal collection or integer range() call.
+  double unwindElement = 0.01;
+};
+
+struct CostFactor {
+  const char* name;
+  double count = 0;
+  double score = 0;
+};
+
+struct QueryCost {
+  CostFactor unboundedRange { "unboundedRange" };
+  CostFactor rangeHops { "rangeHops" };
+  CostFactor cartesianProducts { "cartesianProducts" };
+  CostFactor unwindElements { "unwindElements" };
+  double score = 0;
+  unsigned int nErrors = 0;
+};
+
+// Scores the shapes of queries known to be expensive whatever the data, in one pass over
+// the AST and without building a result tree.
+bool EstimateCost(QueryCost& cost, const char* query, size_t length, const ParseOptions& options, const CostWeights& weights);
+
+#endif //__COST_HPP__
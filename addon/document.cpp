@@ -0,0 +1,78 @@
+#include "document.hpp"
+#include <algorithm>
+#include <iterator>
+
+ScriptDocument::ScriptDocument(const ParseOptions& options): options(options) {
+  this->options.threads = 0;
+  this->options.position = { 1, 1, 0 };
+}
+
+bool ScriptDocument::Edit(size_t start, size_t end, const std::string& text, DocumentDelta& delta) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  start = std::min(index.Unmap(start), this->text.length());
+  end = std::max(std::min(index.Unmap(end), this->text.length()), start);
+  this->text.replace(start, end - start, text);
+  index.Build(this->text.c_str(), this->text.length());
+
+  // The quick scan of statement boundaries is cheap, only full parses are saved.
+  std::vector<QuerySegment> found;
+  if (!NodeBin::Split(found, this->text.c_str(), this->text.length(), options.parseOnlyStatements))
+    return false;
+
+  // Statements with the same boundaries before the edit, or the same boundaries shifted
+  // by the edit after it, have unchanged text and keep their results.
+  auto shift = (ptrdiff_t)text.length() - (ptrdiff_t)(end - start);
+  auto same = [](const QuerySegment& a, const QuerySegment& b, ptrdiff_t shift) {
+    return a.start + shift == b.start && a.end + shift == b.end && a.command == b.command;
+  };
+
+  size_t prefix = 0;
+  while (prefix < segments.size() && prefix < found.size() && segments[prefix].segment.end <= start &&
+         same(segments[prefix].segment, found[prefix], 0))
+    prefix++;
+
+  size_t suffix = 0;
+  while (suffix < segments.size() - prefix && suffix < found.size() - prefix) {
+    auto& segment = segments[segments.size() - 1 - suffix].segment;
+    if (segment.start < end || !same(segment, found[found.size() - 1 - suffix], shift))
+      break;
+    segment = found[found.size() - 1 - suffix];
+    suffix++;
+  }
+
+  auto deleteCount = segments.size() - prefix - suffix;
+  auto count = found.size() - prefix - suffix;
+  std::vector<DocumentSegment> parsed(count);
+  for (size_t i = 0; i < count; i++) {
+    parsed[i].segment = found[prefix + i];
+    if (!ParseSegment(parsed[i]))
+      return false;
+  }
+
+  segments.erase(segments.begin() + prefix, segments.begin() + prefix + deleteCount);
+  segments.insert(segments.begin() + prefix, std::make_move_iterator(parsed.begin()), std::make_move_iterator(parsed.end()));
+
+  delta.index = prefix;
+  delta.deleteCount = deleteCount;
+  delta.segments.clear();
+  for (size_t i = prefix; i < prefix + count; i++) {
+    auto& segment = segments[i].segment;
+    auto position = index.Map({ segment.line, segment.column, segment.start });
+    delta.segments.push_back({ position.offset, index.Map(segment.end), position, segment.command, segments[i].result });
+  }
+  return true;
+}
+
+bool ScriptDocument::ParseSegment(DocumentSegment& segment) const {
+  auto query = text.c_str() + segment.segment.start;
+  auto length = segment.segment.end - segment.segment.start;
+
+  ParseOptions segmentOptions = options;
+  segmentOptions.utf16 = Utf16Index::Length(query, length) != length;
+  auto result = std::make_shared<ParseTree>();
+  NodeBin::Parse(*result, query, length, segmentOptions);
+  segment.result = result;
+
+  return result->document.IsObject();
+}
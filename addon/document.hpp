@@ -0,0 +1,52 @@
+#ifndef __DOCUMENT_HPP__
+#define __DOCUMENT_HPP__
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "parser.hpp"
+
+struct DocumentSegment {
+  QuerySegment segment;
+  std::shared_ptr<const ParseTree> result;
+};
+
+// Change to the segment list, as an Array.splice of segments whose offsets and positions
+// are in utf-16 string indices.
+struct DocumentDelta {
+  struct Segment {
+    size_t start;
+    size_t end;
+    struct cypher_input_position position;
+    bool command;
+    std::shared_ptr<const ParseTree> result;
+  };
+
+  size_t index;
+  size_t deleteCount;
+  std::vector<Segment> segments;
+};
+
+// A script kept between parses, as in an editor session. Every statement is parsed on
+// its own with positions relative to its start, so an edit only reparses the statements
+// whose text it changes, and the results of the others are kept as is.
+class ScriptDocument {
+public:
+  ScriptDocument(const ParseOptions& options);
+
+  // Replaces the text between two utf-16 string indices.
+  bool Edit(size_t start, size_t end, const std::string& text, DocumentDelta& delta);
+  const ParseOptions& Options() const { return options; }
+
+private:
+  bool ParseSegment(DocumentSegment& segment) const;
+
+  ParseOptions options;
+  std::string text;
+  Utf16Index index;
+  std::vector<DocumentSegment> segments;
+  std::mutex mutex;
+};
+
+#endif //__DOCUMENT_HPP__
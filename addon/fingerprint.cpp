@@ -0,0 +1,175 @@
+#include "fingerprint.hpp"
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// FNV-1a hashes each element, and elements are folded in order as the digits of a number
+// in base prime, so the fingerprints of consecutive runs of elements can be combined.
+static const uint64_t offsetBasis = 14695981039346656037ULL;
+static const uint64_t prime = 1099511628211ULL;
+
+uint64_t FingerprintSink::Combine(uint64_t a, uint64_t b, size_t count) {
+  for (size_t i = 0; i < count; i++)
+    a *= prime;
+  return a + b;
+}
+
+std::string FingerprintSink::Text(uint64_t fingerprint) {
+  char text[17];
+  snprintf(text, sizeof(text), "%016" PRIx64, fingerprint);
+  return text;
+}
+
+uint64_t FingerprintSink::Read(const char* text) {
+  return strtoull(text, NULL, 16);
+}
+
+void FingerprintSink::Hash(char tag, const void* data, size_t length) {
+  if (!Hashing())
+    return;
+
+  element = (element ^ (unsigned char)tag) * prime;
+  uint64_t size = length;
+  auto bytes = (const unsigned char*)&size;
+  for (size_t i = 0; i < sizeof(size); i++)
+    element = (element ^ bytes[i]) * prime;
+  bytes = (const unsigned char*)data;
+  for (size_t i = 0; i < length; i++)
+    element = (element ^ bytes[i]) * prime;
+}
+
+void FingerprintSink::EndElement() {
+  fingerprint = fingerprint * prime + element;
+  count++;
+  element = offsetBasis;
+}
+
+void FingerprintSink::Scalar(char tag, const void* data, size_t length) {
+  if (pending) {
+    pending = false;
+    return;
+  }
+  Hash(tag, data, length);
+  if (arrayDepth && depth == arrayDepth && skipFrom < 0)
+    EndElement();
+}
+
+// Skipped keys are hashed after all when their value is an object, as map entries named
+// like range or binding, whose values are always nodes.
+void FingerprintSink::Open(char tag) {
+  if (pending) {
+    pending = false;
+    if (tag == '{')
+      Hash('k', pendingKey.data(), pendingKey.length());
+    else
+      skipFrom = depth;
+  }
+  Hash(tag, NULL, 0);
+  depth++;
+}
+
+void FingerprintSink::Close(char tag) {
+  depth--;
+  if (skipFrom == depth) {
+    skipFrom = -1;
+    return;
+  }
+  Hash(tag, NULL, 0);
+  if (arrayDepth && depth == arrayDepth && skipFrom < 0)
+    EndElement();
+}
+
+bool FingerprintSink::Null() {
+  Scalar('n', NULL, 0);
+  return sink.Null();
+}
+
+bool FingerprintSink::Bool(bool b) {
+  Scalar(b ? 't' : 'f', NULL, 0);
+  return sink.Bool(b);
+}
+
+// Integers hash the same whichever width they are written with.
+bool FingerprintSink::Int(int i) {
+  int64_t value = i;
+  Scalar('i', &value, sizeof(value));
+  return sink.Int(i);
+}
+
+bool FingerprintSink::Uint(unsigned u) {
+  int64_t value = u;
+  Scalar('i', &value, sizeof(value));
+  return sink.Uint(u);
+}
+
+bool FingerprintSink::Int64(int64_t i) {
+  Scalar('i', &i, sizeof(i));
+  return sink.Int64(i);
+}
+
+bool FingerprintSink::Uint64(uint64_t u) {
+  Scalar('i', &u, sizeof(u));
+  return sink.Uint64(u);
+}
+
+bool FingerprintSink::Double(double d) {
+  Scalar('d', &d, sizeof(d));
+  return sink.Double(d);
+}
+
+bool FingerprintSink::RawNumber(const char* str, rapidjson::SizeType length, bool copy) {
+  Scalar('r', str, length);
+  return sink.RawNumber(str, length, copy);
+}
+
+bool FingerprintSink::String(const char* str, rapidjson::SizeType length, bool copy) {
+  Scalar('s', str, length);
+  return sink.String(str, length, copy);
+}
+
+bool FingerprintSink::StartObject() {
+  Open('{');
+  return sink.StartObject();
+}
+
+bool FingerprintSink::Key(const char* str, rapidjson::SizeType length, bool copy) {
+  if (Hashing() && depth > arrayDepth) {
+    for (auto& name : skipped) {
+      if (name.length() == length && !memcmp(name.data(), str, length)) {
+        pending = true;
+        pendingKey.assign(str, length);
+        return sink.Key(str, length, copy);
+      }
+    }
+  }
+  Hash('k', str, length);
+  return sink.Key(str, length, copy);
+}
+
+bool FingerprintSink::EndObject(rapidjson::SizeType memberCount) {
+  Close('}');
+  return sink.EndObject(memberCount);
+}
+
+bool FingerprintSink::StartArray() {
+  if (armed && !pending) {
+    armed = false;
+    depth++;
+    arrayDepth = depth;
+    element = offsetBasis;
+    return sink.StartArray();
+  }
+  Open('[');
+  return sink.StartArray();
+}
+
+bool FingerprintSink::EndArray(rapidjson::SizeType elementCount) {
+  if (arrayDepth && depth == arrayDepth) {
+    depth--;
+    arrayDepth = 0;
+    return sink.EndArray(elementCount);
+  }
+  Close(']');
+  return sink.EndArray(elementCount);
+}
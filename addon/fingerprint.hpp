@@ -0,0 +1,67 @@
+#ifndef __FINGERPRINT_HPP__
+#define __FINGERPRINT_HPP__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "sink.hpp"
+
+// Forwards a result to another sink, and hashes the elements of one array of it into a
+// fingerprint, as the directives of a parse. Range and binding members are left out, so
+// queries differing only in whitespace, comments and positions share a fingerprint.
+class FingerprintSink : public ResultSink {
+public:
+  // Skipped names are the keys of range and binding members, full or compact.
+  FingerprintSink(ResultSink& sink, const std::vector<std::string>& skipped): sink(sink), skipped(skipped) {}
+
+  // Hashes the elements of the next array started.
+  void HashNextArray() { armed = true; }
+  uint64_t Fingerprint() const { return fingerprint; }
+  // Number of elements hashed.
+  size_t Count() const { return count; }
+
+  // Fingerprint of the elements hashed in a, followed by count elements hashed in b.
+  static uint64_t Combine(uint64_t a, uint64_t b, size_t count);
+  static std::string Text(uint64_t fingerprint);
+  static uint64_t Read(const char* text);
+
+  bool Null();
+  bool Bool(bool b);
+  bool Int(int i);
+  bool Uint(unsigned u);
+  bool Int64(int64_t i);
+  bool Uint64(uint64_t u);
+  bool Double(double d);
+  bool RawNumber(const char* str, rapidjson::SizeType length, bool copy);
+  bool String(const char* str, rapidjson::SizeType length, bool copy);
+  bool StartObject();
+  bool Key(const char* str, rapidjson::SizeType length, bool copy);
+  bool EndObject(rapidjson::SizeType memberCount);
+  bool StartArray();
+  bool EndArray(rapidjson::SizeType elementCount);
+
+private:
+  bool Hashing() const { return arrayDepth && depth >= arrayDepth && skipFrom < 0; }
+  void Hash(char tag, const void* data, size_t length);
+  void Scalar(char tag, const void* data, size_t length);
+  void Open(char tag);
+  void Close(char tag);
+  void EndElement();
+
+  ResultSink& sink;
+  std::vector<std::string> skipped;
+  bool armed = false;
+  // Depth of open objects and arrays, and of the hashed array, 0 when there is none.
+  int depth = 0;
+  int arrayDepth = 0;
+  // Skipped key waiting for its value, hashed after all if the value is a node.
+  std::string pendingKey;
+  bool pending = false;
+  // Depth of the skipped array being written, -1 when there is none.
+  int skipFrom = -1;
+  uint64_t element = 0;
+  uint64_t fingerprint = 0;
+  size_t count = 0;
+};
+
+#endif //__FINGERPRINT_HPP__
@@ -0,0 +1,71 @@
+#include "handle.hpp"
+
+ParserHandle::ParserHandle(const ParseOptions& options, const ParserLimits& limits):
+    options(options),
+    limits(limits) {
+  this->options.config = NodeBin::NewConfig(options);
+}
+
+ParserHandle::~ParserHandle() {
+  if (options.config)
+    cypher_parser_config_free(options.config);
+}
+
+bool ParserHandle::Parse(std::shared_ptr<const ParseTree>& tree, const std::string& query, bool utf16, std::string& error) {
+  if (limits.maxQueryLength && query.length() > limits.maxQueryLength) {
+    metrics.rejected++;
+    error = "Query length exceeds maxQueryLength.";
+    return false;
+  }
+
+  bool succeeded;
+  if (Lookup(query, tree, succeeded)) {
+    metrics.cacheHits++;
+    return succeeded;
+  }
+
+  auto started = std::chrono::steady_clock::now();
+  ParseOptions queryOptions = options;
+  queryOptions.utf16 = utf16;
+  auto parsed = std::make_shared<ParseTree>();
+  succeeded = NodeBin::Parse(*parsed, query.c_str(), query.length(), queryOptions);
+  metrics.Record(query.length(), std::chrono::steady_clock::now() - started, succeeded);
+
+  tree = parsed;
+  if (parsed->document.IsObject())
+    Store(query, tree, succeeded);
+  return succeeded;
+}
+
+bool ParserHandle::Lookup(const std::string& query, std::shared_ptr<const ParseTree>& tree, bool& succeeded) {
+  if (!limits.cacheSize)
+    return false;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto found = cache.find(query);
+  if (found == cache.end())
+    return false;
+
+  entries.splice(entries.begin(), entries, found->second);
+  tree = found->second->tree;
+  succeeded = found->second->succeeded;
+  return true;
+}
+
+void ParserHandle::Store(const std::string& query, const std::shared_ptr<const ParseTree>& tree, bool succeeded) {
+  if (!limits.cacheSize)
+    return;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (cache.count(query))
+    return;
+
+  if (entries.size() >= limits.cacheSize) {
+    cache.erase(*entries.back().query);
+    entries.pop_back();
+  }
+
+  entries.push_front({ NULL, tree, succeeded });
+  auto inserted = cache.emplace(query, entries.begin());
+  entries.front().query = &inserted.first->first;
+}
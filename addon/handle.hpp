@@ -0,0 +1,66 @@
+#ifndef __HANDLE_HPP__
+#define __HANDLE_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "parser.hpp"
+
+struct ParserLimits {
+  size_t maxQueryLength = 0;
+  size_t cacheSize = 0;
+};
+
+struct ParserMetrics {
+  std::atomic<uint64_t> parses { 0 };
+  std::atomic<uint64_t> cacheHits { 0 };
+  std::atomic<uint64_t> failures { 0 };
+  std::atomic<uint64_t> rejected { 0 };
+  std::atomic<uint64_t> bytes { 0 };
+  std::atomic<uint64_t> nanoseconds { 0 };
+
+  void Record(size_t length, std::chrono::steady_clock::duration elapsed, bool succeeded) {
+    parses++;
+    bytes += length;
+    nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    if (!succeeded)
+      failures++;
+  }
+};
+
+// Parser state kept between queries: options and libcypher-parser config are set up once,
+// results are kept in a least recently used cache, and limits and metrics are per handle.
+// Parse may be called from several threads at once.
+class ParserHandle {
+public:
+  ParserHandle(const ParseOptions& options, const ParserLimits& limits);
+  ~ParserHandle();
+
+  bool Parse(std::shared_ptr<const ParseTree>& tree, const std::string& query, bool utf16, std::string& error);
+  const ParseOptions& Options() const { return options; }
+  const ParserMetrics& Metrics() const { return metrics; }
+
+private:
+  struct CacheEntry {
+    const std::string* query;
+    std::shared_ptr<const ParseTree> tree;
+    bool succeeded;
+  };
+
+  bool Lookup(const std::string& query, std::shared_ptr<const ParseTree>& tree, bool& succeeded);
+  void Store(const std::string& query, const std::shared_ptr<const ParseTree>& tree, bool succeeded);
+
+  ParseOptions options;
+  ParserLimits limits;
+  ParserMetrics metrics;
+  std::list<CacheEntry> entries;
+  std::unordered_map<std::string, std::list<CacheEntry>::iterator> cache;
+  std::mutex mutex;
+};
+
+#endif //__HANDLE_HPP__
@@ -0,0 +1,115 @@
+#include "keys.hpp"
+#include <cstring>
+#include "parser.hpp"
+
+using namespace v8;
+
+// Names of the objects made by the binding itself, besides parse results.
+static const char* const bindingNames[] = {
+  "index", "deleteCount", "segments", "result",
+  "parses", "cacheHits", "failures", "rejected", "bytes", "parseTime",
+  "relTypes", "propertyKeys", "procedures", "parameters",
+  "kind", "read", "write", "schema", "procedure",
+  "score", "factors", "count", "unboundedRange", "rangeHops", "cartesianProducts", "unwindElements",
+  "edits"
+};
+
+KeyTable::KeyTable(Isolate* isolate): isolate(isolate) {
+  for (auto name : bindingNames)
+    index.Add(name);
+  for (auto& key : NodeBin::CompactKeys())
+    index.Add(key.c_str());
+
+  for (size_t id = 0; id < index.Size(); id++) {
+    auto string = String::NewFromUtf8(isolate, index.Name((int)id), NewStringType::kInternalized, (int)index.Length((int)id));
+    strings.emplace_back(isolate, string.ToLocalChecked());
+  }
+}
+
+Local<String> KeyTable::Get(const char* name, size_t length) const {
+  auto id = index.Find(name, length);
+  if (id != -1)
+    return Local<String>::New(isolate, strings[id]);
+  return Nan::New(name, (int)length).ToLocalChecked();
+}
+
+Local<String> KeyTable::Get(const char* name) const {
+  return Get(name, strlen(name));
+}
+
+Local<Value> KeyTable::Build(const rapidjson::Value& value, bool fixedShapes) const {
+  switch (value.GetType()) {
+  case rapidjson::kNullType:
+    return Nan::Null();
+  case rapidjson::kFalseType:
+    return Nan::False();
+  case rapidjson::kTrueType:
+    return Nan::True();
+  case rapidjson::kStringType:
+    return Get(value.GetString(), value.GetStringLength());
+  case rapidjson::kNumberType:
+    if (value.IsInt())
+      return Nan::New<Integer>(value.GetInt());
+    return Nan::New<Number>(value.GetDouble());
+  case rapidjson::kArrayType: {
+    std::vector<Local<Value>> elements;
+    elements.reserve(value.Size());
+    for (auto& element : value.GetArray())
+      elements.push_back(Build(element, fixedShapes));
+    return Array::New(isolate, elements.data(), elements.size());
+  }
+  case rapidjson::kObjectType:
+    return BuildObject(value, fixedShapes);
+  }
+  return Nan::Undefined();
+}
+
+Local<Value> KeyTable::BuildObject(const rapidjson::Value& value, bool fixedShapes) const {
+  auto context = isolate->GetCurrentContext();
+  auto shape = fixedShapes ? GetShape(value) : NULL;
+  auto object = shape
+    ? Local<ObjectTemplate>::New(isolate, shape->objectTemplate)->NewInstance(context).ToLocalChecked()
+    : Object::New(isolate);
+
+  for (auto& member : value.GetObject())
+    object->CreateDataProperty(context, Get(member.name.GetString(), member.name.GetStringLength()), Build(member.value, fixedShapes)).FromJust();
+  return object;
+}
+
+// Nodes start with their type member. Nodes whose members differ from the shape of their
+// type, as with map entries, are made as plain objects.
+const KeyTable::Shape* KeyTable::GetShape(const rapidjson::Value& value) const {
+  if (value.ObjectEmpty())
+    return NULL;
+
+  auto& first = *value.MemberBegin();
+  if (strcmp(first.name.GetString(), "type") || !first.value.IsString())
+    return NULL;
+
+  auto type = index.Find(first.value.GetString(), first.value.GetStringLength());
+  if (type == -1)
+    return NULL;
+
+  std::vector<int> keys;
+  keys.reserve(value.MemberCount());
+  for (auto& member : value.GetObject()) {
+    auto key = index.Find(member.name.GetString(), member.name.GetStringLength());
+    if (key == -1)
+      return NULL;
+    keys.push_back(key);
+  }
+
+  if (shapes.size() <= (size_t)type)
+    shapes.resize(index.Size());
+  auto& shape = shapes[type];
+  if (!shape) {
+    auto objectTemplate = ObjectTemplate::New(isolate);
+    for (auto key : keys)
+      objectTemplate->Set(Local<String>::New(isolate, strings[key]), Nan::Null());
+    shape.reset(new Shape());
+    shape->keys = keys;
+    shape->objectTemplate.Reset(isolate, objectTemplate);
+  }
+
+  return shape->keys == keys ? shape.get() : NULL;
+}
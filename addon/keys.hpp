@@ -0,0 +1,40 @@
+#ifndef __KEYS_HPP__
+#define __KEYS_HPP__
+
+#include <nan.h>
+#include <memory>
+#include <vector>
+#include "rapidjson/document.h"
+#include "names.hpp"
+
+// Internalized V8 strings for every member name and type value of parse results, created
+// once per isolate, and the builder making JS values from result trees with them.
+class KeyTable {
+public:
+  explicit KeyTable(v8::Isolate* isolate);
+
+  v8::Local<v8::String> Get(const char* name, size_t length) const;
+  v8::Local<v8::String> Get(const char* name) const;
+  // With fixed shapes, every node of a type is made from one object template, so nodes
+  // of a type share a hidden class and JS property access on them stays monomorphic.
+  v8::Local<v8::Value> Build(const rapidjson::Value& value, bool fixedShapes = false) const;
+  const NameIndex& Names() const { return index; }
+
+private:
+  struct Shape {
+    std::vector<int> keys;
+    v8::Global<v8::ObjectTemplate> objectTemplate;
+  };
+
+  v8::Local<v8::Value> BuildObject(const rapidjson::Value& value, bool fixedShapes) const;
+  const Shape* GetShape(const rapidjson::Value& value) const;
+
+  v8::Isolate* isolate;
+  NameIndex index;
+  // Interned strings by name id.
+  std::vector<v8::Global<v8::String>> strings;
+  // Shapes by type name index, made from the first node seen of each type.
+  mutable std::vector<std::unique_ptr<Shape>> shapes;
+};
+
+#endif //__KEYS_HPP__
@@ -0,0 +1,255 @@
+#include "lint.hpp"
+#include <cstring>
+#include <strings.h>
+
+static const std::vector<const char*> ruleNames = {
+  "missing-limit", "leading-optional-match", "start-clause", "unbound-identifier",
+  "unknown-label", "unknown-rel-type", "unknown-property", "unbound-variable", "shadowed-variable"
+};
+
+static const std::vector<const PerfectHashSet*> noPropertySets;
+
+static const char* const aggregates[] = {
+  "count", "sum", "avg", "min", "max", "collect", "stdev", "stdevp", "percentileCont", "percentileDisc"
+};
+
+Linter::Linter(unsigned int rules, const GraphSchema* schema, bool scopes, const char* text, size_t length, size_t offset):
+    rules(rules | (schema ? SchemaRules() : 0) | (scopes ? ScopeRules() : 0)),
+    schema(schema),
+    text(text),
+    length(length),
+    offset(offset),
+    resolver(scopes || schema || (rules & 1u << (int)LintRule::UnboundIdentifier) ? new ScopeResolver() : NULL) {}
+
+const char* Linter::RuleName(LintRule rule) {
+  return ruleNames[(int)rule];
+}
+
+unsigned int Linter::RuleBit(const char* name) {
+  for (size_t i = 0; i < ruleNames.size(); i++) {
+    if (!strcmp(name, ruleNames[i]))
+      return 1u << i;
+  }
+  return 0;
+}
+
+const std::vector<const char*>& Linter::RuleNames() {
+  return ruleNames;
+}
+
+unsigned int Linter::SchemaRules() {
+  return 1u << (int)LintRule::UnknownLabel | 1u << (int)LintRule::UnknownRelType | 1u << (int)LintRule::UnknownProperty;
+}
+
+unsigned int Linter::ScopeRules() {
+  return 1u << (int)LintRule::UnboundVariable | 1u << (int)LintRule::ShadowedVariable;
+}
+
+void Linter::Report(LintRule rule, const cypher_astnode_t* node, const std::string& message) {
+  diagnostics.push_back({ rule, cypher_astnode_range(node).start, message });
+}
+
+std::string Linter::Context(const struct cypher_input_position& position, size_t& contextOffset) const {
+  size_t at = position.offset >= offset ? position.offset - offset : 0;
+  if (at > length)
+    at = length;
+
+  size_t start = at;
+  while (start > 0 && text[start - 1] != '\n')
+    start--;
+  size_t end = at;
+  while (end < length && text[end] != '\n' && text[end] != '\r')
+    end++;
+
+  contextOffset = at - start;
+  return std::string(text + start, end - start);
+}
+
+static bool IsAggregate(const cypher_astnode_t* expression) {
+  const cypher_astnode_t* name;
+  auto type = cypher_astnode_type(expression);
+  if (type == CYPHER_AST_APPLY_OPERATOR)
+    name = cypher_ast_apply_operator_get_func_name(expression);
+  else if (type == CYPHER_AST_APPLY_ALL_OPERATOR)
+    name = cypher_ast_apply_all_operator_get_func_name(expression);
+  else
+    return false;
+
+  auto value = cypher_ast_function_name_get_value(name);
+  for (auto aggregate : aggregates) {
+    if (!strcasecmp(value, aggregate))
+      return true;
+  }
+  return false;
+}
+
+void Linter::CheckQuery(const cypher_astnode_t* query) {
+  if (!Enabled(LintRule::LeadingOptionalMatch) || !cypher_ast_query_nclauses(query))
+    return;
+
+  auto first = cypher_ast_query_get_clause(query, 0);
+  if (cypher_astnode_type(first) == CYPHER_AST_MATCH && cypher_ast_match_is_optional(first))
+    Report(LintRule::LeadingOptionalMatch, first, "OPTIONAL MATCH as the first clause returns a row of nulls when nothing matches, use MATCH.");
+}
+
+// Returns of aggregates only are one row, and need no limit.
+void Linter::CheckReturn(const cypher_astnode_t* clause) {
+  if (!Enabled(LintRule::MissingLimit) || cypher_ast_return_get_limit(clause))
+    return;
+
+  auto nprojections = cypher_ast_return_nprojections(clause);
+  bool aggregates = nprojections > 0;
+  for (unsigned int i = 0; i < nprojections && aggregates; i++)
+    aggregates = IsAggregate(cypher_ast_projection_get_expression(cypher_ast_return_get_projection(clause, i)));
+  if (!aggregates || cypher_ast_return_has_include_existing(clause))
+    Report(LintRule::MissingLimit, clause, "RETURN without LIMIT can return any number of rows.");
+}
+
+// Labels and types of a pattern add their property keys to sets, when they are in the schema.
+void Linter::CheckLabel(const cypher_astnode_t* label, PropertySets* sets) {
+  auto name = cypher_ast_label_get_name(label);
+  auto id = schema->Labels().Find(name, strlen(name));
+  if (id == -1)
+    Report(LintRule::UnknownLabel, label, "Label `" + std::string(name) + "` is not in the schema.");
+  else if (sets)
+    sets->push_back(&schema->LabelProperties(id));
+}
+
+void Linter::CheckRelType(const cypher_astnode_t* relType, PropertySets* sets) {
+  auto name = cypher_ast_reltype_get_name(relType);
+  auto id = schema->RelTypes().Find(name, strlen(name));
+  if (id == -1)
+    Report(LintRule::UnknownRelType, relType, "Relationship type `" + std::string(name) + "` is not in the schema.");
+  else if (sets)
+    sets->push_back(&schema->RelTypeProperties(id));
+}
+
+// Keys of the labels or types known for a variable, or of the whole schema without them.
+void Linter::CheckProperty(const cypher_astnode_t* propName, const PropertySets& sets) {
+  auto name = cypher_ast_prop_name_get_value(propName);
+  auto length = strlen(name);
+  bool found = sets.empty() && schema->Properties().Find(name, length) != -1;
+  for (auto set : sets)
+    found = found || set->Find(name, length) != -1;
+  if (!found)
+    Report(LintRule::UnknownProperty, propName, "Property `" + std::string(name) + "` is not in the schema.");
+}
+
+void Linter::CheckPattern(const cypher_astnode_t* properties, PropertySets& sets) {
+  if (properties && cypher_astnode_type(properties) == CYPHER_AST_MAP) {
+    for (unsigned int i = 0; i < cypher_ast_map_nentries(properties); i++)
+      CheckProperty(cypher_ast_map_get_key(properties, i), sets);
+  }
+  patternSets.swap(sets);
+}
+
+void Linter::CheckSelectors(const cypher_astnode_t* projection, const PropertySets& sets) {
+  for (unsigned int i = 0; i < cypher_ast_map_projection_nselectors(projection); i++) {
+    auto selector = cypher_ast_map_projection_get_selector(projection, i);
+    if (cypher_astnode_type(selector) == CYPHER_AST_MAP_PROJECTION_PROPERTY)
+      CheckProperty(cypher_ast_map_projection_property_get_prop_name(selector), sets);
+  }
+}
+
+// Property keys known for the variable of the identifier last resolved.
+const Linter::PropertySets& Linter::VariableProperties() const {
+  auto found = properties.find(resolver->Current());
+  return found == properties.end() ? noPropertySets : found->second;
+}
+
+// Labels and types are checked where their nodes are. Property keys only where they are keys
+// of nodes or relationships, not of map literals.
+void Linter::CheckSchema(const cypher_astnode_t* node, cypher_astnode_type_t type) {
+  if (type == CYPHER_AST_NODE_PATTERN) {
+    PropertySets sets;
+    for (unsigned int i = 0; i < cypher_ast_node_pattern_nlabels(node); i++)
+      CheckLabel(cypher_ast_node_pattern_get_label(node, i), &sets);
+    CheckPattern(cypher_ast_node_pattern_get_properties(node), sets);
+  }
+  else if (type == CYPHER_AST_REL_PATTERN) {
+    PropertySets sets;
+    for (unsigned int i = 0; i < cypher_ast_rel_pattern_nreltypes(node); i++)
+      CheckRelType(cypher_ast_rel_pattern_get_reltype(node, i), &sets);
+    CheckPattern(cypher_ast_rel_pattern_get_properties(node), sets);
+  }
+  else if (type == CYPHER_AST_LABEL) {
+    // Pattern labels are checked with their pattern.
+    if (parents.empty() || cypher_astnode_type(parents.back()) != CYPHER_AST_NODE_PATTERN)
+      CheckLabel(node, NULL);
+  }
+  else if (type == CYPHER_AST_RELTYPE) {
+    if (parents.empty() || cypher_astnode_type(parents.back()) != CYPHER_AST_REL_PATTERN)
+      CheckRelType(node, NULL);
+  }
+  // Keys of variables are checked with the variable, once it is resolved.
+  else if (type == CYPHER_AST_PROPERTY_OPERATOR) {
+    if (cypher_astnode_type(cypher_ast_property_operator_get_expression(node)) != CYPHER_AST_IDENTIFIER)
+      CheckProperty(cypher_ast_property_operator_get_prop_name(node), noPropertySets);
+  }
+  else if (type == CYPHER_AST_MAP_PROJECTION) {
+    if (cypher_astnode_type(cypher_ast_map_projection_get_expression(node)) != CYPHER_AST_IDENTIFIER)
+      CheckSelectors(node, noPropertySets);
+  }
+  else if (type == CYPHER_AST_CREATE_NODE_PROP_INDEX || type == CYPHER_AST_DROP_NODE_PROP_INDEX) {
+    bool create = type == CYPHER_AST_CREATE_NODE_PROP_INDEX;
+    auto label = create ? cypher_ast_create_node_prop_index_get_label(node) : cypher_ast_drop_node_prop_index_get_label(node);
+    auto propName = create ? cypher_ast_create_node_prop_index_get_prop_name(node) : cypher_ast_drop_node_prop_index_get_prop_name(node);
+    auto name = cypher_ast_label_get_name(label);
+    auto id = schema->Labels().Find(name, strlen(name));
+    if (id != -1)
+      CheckProperty(propName, { &schema->LabelProperties(id) });
+  }
+}
+
+// Identifiers are checked once the resolver found their binding, with the node holding them.
+void Linter::CheckIdentifier(const cypher_astnode_t* identifier) {
+  std::string name = cypher_ast_identifier_get_name(identifier);
+  auto problem = resolver->CurrentProblem();
+  auto parent = parents.empty() ? NULL : parents.back();
+  auto type = parent ? cypher_astnode_type(parent) : CYPHER_AST_IDENTIFIER;
+  if (type == CYPHER_AST_PROPERTY_OPERATOR && problem == ScopeResolver::Unbound && Enabled(LintRule::UnboundIdentifier))
+    Report(LintRule::UnboundIdentifier, identifier, "Variable `" + name + "` not defined.");
+  if (problem == ScopeResolver::Unbound && Enabled(LintRule::UnboundVariable))
+    Report(LintRule::UnboundVariable, identifier, "Variable `" + name + "` not defined.");
+  else if (problem == ScopeResolver::Shadowed && Enabled(LintRule::ShadowedVariable))
+    Report(LintRule::ShadowedVariable, identifier, "Variable `" + name + "` shadows a variable bound before it.");
+
+  if (!schema || resolver->Current() == -1)
+    return;
+  if (type == CYPHER_AST_NODE_PATTERN || type == CYPHER_AST_REL_PATTERN) {
+    auto& known = properties[resolver->Current()];
+    known.insert(known.end(), patternSets.begin(), patternSets.end());
+  }
+  else if (type == CYPHER_AST_PROPERTY_OPERATOR)
+    CheckProperty(cypher_ast_property_operator_get_prop_name(parent), VariableProperties());
+  else if (type == CYPHER_AST_MAP_PROJECTION)
+    CheckSelectors(parent, VariableProperties());
+}
+
+// Everything is checked when its node is entered, identifiers after the resolver bound them,
+// so names are known to everything after them in the walk.
+void Linter::Enter(const cypher_astnode_t* node) {
+  auto type = cypher_astnode_type(node);
+  if (schema)
+    CheckSchema(node, type);
+
+  if (resolver) {
+    resolver->Enter(node);
+    if (type == CYPHER_AST_IDENTIFIER)
+      CheckIdentifier(node);
+  }
+  parents.push_back(node);
+
+  if (type == CYPHER_AST_QUERY)
+    CheckQuery(node);
+  else if (type == CYPHER_AST_START && Enabled(LintRule::StartClause))
+    Report(LintRule::StartClause, node, "START is deprecated, use MATCH with an index hint or an id() predicate.");
+  else if (type == CYPHER_AST_RETURN)
+    CheckReturn(node);
+}
+
+void Linter::Leave(const cypher_astnode_t* node) {
+  parents.pop_back();
+  if (resolver)
+    resolver->Leave(node);
+}
@@ -0,0 +1,88 @@
+#ifndef __LINT_HPP__
+#define __LINT_HPP__
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cypher-parser.h>
+#include "schema.hpp"
+#include "scopes.hpp"
+
+// Rules are bits of ParseOptions.lint, in the order of their names.
+enum class LintRule {
+  MissingLimit,
+  LeadingOptionalMatch,
+  StartClause,
+  UnboundIdentifier,
+  // Checked against the schema option.
+  UnknownLabel,
+  UnknownRelType,
+  UnknownProperty,
+  // Checked with the scopes option.
+  UnboundVariable,
+  ShadowedVariable
+};
+
+struct LintDiagnostic {
+  LintRule rule;
+  struct cypher_input_position position;
+  std::string message;
+};
+
+// Checks the enabled rules on every node as NodeBin walks the AST, so all of them take
+// one pass, shared with building the result. One linter is made per parse result.
+class Linter {
+public:
+  Linter(unsigned int rules, const GraphSchema* schema, bool scopes, const char* text, size_t length, size_t offset);
+
+  void Enter(const cypher_astnode_t* node);
+  void Leave(const cypher_astnode_t* node);
+  const std::vector<LintDiagnostic>& Diagnostics() const { return diagnostics; }
+  // Bindings of identifiers, with the scopes option.
+  const ScopeResolver* Resolver() const { return resolver.get(); }
+  // Line of the parsed text holding a position, and the offset of the position in it.
+  std::string Context(const struct cypher_input_position& position, size_t& contextOffset) const;
+
+  static const char* RuleName(LintRule rule);
+  // Bit of a rule name, 0 for unknown names.
+  static unsigned int RuleBit(const char* name);
+  static const std::vector<const char*>& RuleNames();
+  // Rules checked whenever a schema is given.
+  static unsigned int SchemaRules();
+  static unsigned int ScopeRules();
+
+private:
+  typedef std::vector<const PerfectHashSet*> PropertySets;
+
+  bool Enabled(LintRule rule) const { return rules & (1u << (int)rule); }
+  void Report(LintRule rule, const cypher_astnode_t* node, const std::string& message);
+  void CheckQuery(const cypher_astnode_t* query);
+  void CheckReturn(const cypher_astnode_t* clause);
+  void CheckSchema(const cypher_astnode_t* node, cypher_astnode_type_t type);
+  void CheckIdentifier(const cypher_astnode_t* identifier);
+  void CheckPattern(const cypher_astnode_t* properties, PropertySets& sets);
+  void CheckProperty(const cypher_astnode_t* propName, const PropertySets& sets);
+  void CheckLabel(const cypher_astnode_t* label, PropertySets* sets);
+  void CheckRelType(const cypher_astnode_t* relType, PropertySets* sets);
+  void CheckSelectors(const cypher_astnode_t* projection, const PropertySets& sets);
+  const PropertySets& VariableProperties() const;
+
+  unsigned int rules;
+  const GraphSchema* schema;
+  const char* text;
+  size_t length;
+  // Offset of the text in the whole query, for texts parsed in chunks.
+  size_t offset;
+  // Bindings of identifiers, for the rules on variables and the property keys of variables.
+  std::unique_ptr<ScopeResolver> resolver;
+  // Property keys of the labels or relationship types of pattern variables, by binding, from the schema.
+  std::unordered_map<int, PropertySets> properties;
+  // Property keys of the pattern entered last, kept for its variable.
+  PropertySets patternSets;
+  // Nodes entered and not yet left.
+  std::vector<const cypher_astnode_t*> parents;
+  std::vector<LintDiagnostic> diagnostics;
+};
+
+#endif //__LINT_HPP__
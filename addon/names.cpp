@@ -0,0 +1,52 @@
+#include "names.hpp"
+#include <cstring>
+#include "parser.hpp"
+
+static size_t Hash(const char* name, size_t length) {
+  size_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++)
+    hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+  return hash;
+}
+
+NameIndex::NameIndex(): slots(512, -1) {
+  for (auto name : NodeBin::Names())
+    Add(name);
+}
+
+int NameIndex::Add(const char* name) {
+  auto length = strlen(name);
+  auto id = Find(name, length);
+  if (id != -1)
+    return id;
+
+  id = (int)names.size();
+  names.push_back(name);
+  lengths.push_back(length);
+
+  if (names.size() * 2 > slots.size()) {
+    slots.assign(slots.size() * 2, -1);
+    for (int i = 0; i < id; i++)
+      Insert(i);
+  }
+  Insert(id);
+  return id;
+}
+
+void NameIndex::Insert(int id) {
+  auto mask = slots.size() - 1;
+  auto slot = Hash(names[id], lengths[id]) & mask;
+  while (slots[slot] != -1)
+    slot = (slot + 1) & mask;
+  slots[slot] = id;
+}
+
+int NameIndex::Find(const char* name, size_t length) const {
+  auto mask = slots.size() - 1;
+  for (auto slot = Hash(name, length) & mask; slots[slot] != -1; slot = (slot + 1) & mask) {
+    auto id = slots[slot];
+    if (lengths[id] == length && !memcmp(names[id], name, length))
+      return id;
+  }
+  return -1;
+}
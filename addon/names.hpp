@@ -0,0 +1,29 @@
+#ifndef __NAMES_HPP__
+#define __NAMES_HPP__
+
+#include <cstddef>
+#include <vector>
+
+// Ids of the member names and type values of parse results, in the order of NodeBin::Names,
+// found through an open addressing hash table. Names added later get the following ids.
+// Lookups are safe from any thread once names are no longer added.
+class NameIndex {
+public:
+  NameIndex();
+
+  int Add(const char* name);
+  int Find(const char* name, size_t length) const;
+  size_t Size() const { return names.size(); }
+  const char* Name(int id) const { return names[id]; }
+  size_t Length(int id) const { return lengths[id]; }
+
+private:
+  void Insert(int id);
+
+  std::vector<const char*> names;
+  std::vector<size_t> lengths;
+  // Indices into names, -1 for empty slots.
+  std::vector<int> slots;
+};
+
+#endif //__NAMES_HPP__
@@ -0,0 +1,393 @@
+#include "normalize.hpp"
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+
+static Constant MakeNull() {
+  Constant value;
+  value.kind = Constant::Null;
+  return value;
+}
+
+static Constant MakeBoolean(bool boolean) {
+  Constant value;
+  value.kind = Constant::Boolean;
+  value.boolean = boolean;
+  return value;
+}
+
+static Constant MakeInteger(int64_t integer) {
+  Constant value;
+  value.kind = Constant::Integer;
+  value.integer = integer;
+  return value;
+}
+
+// Infinite and NaN results are left to the database.
+static Constant MakeFloat(double number) {
+  Constant value;
+  if (!std::isfinite(number))
+    return value;
+  value.kind = Constant::Float;
+  value.number = number;
+  return value;
+}
+
+static Constant MakeString(std::string string) {
+  Constant value;
+  value.kind = Constant::String;
+  value.string = std::move(string);
+  return value;
+}
+
+static bool IsNumber(const Constant& value) {
+  return value.kind == Constant::Integer || value.kind == Constant::Float;
+}
+
+static double Number(const Constant& value) {
+  return value.kind == Constant::Integer ? (double)value.integer : value.number;
+}
+
+static bool IsLogical(const Constant& value) {
+  return value.kind == Constant::Boolean || value.kind == Constant::Null;
+}
+
+// Values of different kinds are not equal, except integers and floats.
+static Constant Equal(const Constant& a, const Constant& b) {
+  if (a.kind == Constant::Null || b.kind == Constant::Null)
+    return MakeNull();
+  if (a.kind == Constant::Integer && b.kind == Constant::Integer)
+    return MakeBoolean(a.integer == b.integer);
+  if (IsNumber(a) && IsNumber(b))
+    return MakeBoolean(Number(a) == Number(b));
+  if (a.kind != b.kind)
+    return MakeBoolean(false);
+  if (a.kind == Constant::String)
+    return MakeBoolean(a.string == b.string);
+  return MakeBoolean(a.boolean == b.boolean);
+}
+
+// Sign of a - b, for values of kinds Cypher orders, or null.
+static Constant Order(const Constant& a, const Constant& b) {
+  if (a.kind == Constant::Integer && b.kind == Constant::Integer)
+    return MakeInteger(a.integer < b.integer ? -1 : a.integer > b.integer);
+  if (IsNumber(a) && IsNumber(b))
+    return MakeInteger(Number(a) < Number(b) ? -1 : Number(a) > Number(b));
+  if (a.kind == Constant::String && b.kind == Constant::String)
+    return MakeInteger(a.string.compare(b.string) < 0 ? -1 : a.string.compare(b.string) > 0);
+  if (a.kind == Constant::Boolean && b.kind == Constant::Boolean)
+    return MakeInteger((int)a.boolean - (int)b.boolean);
+  return MakeNull();
+}
+
+// Three valued logic, where null is unknown.
+static Constant And(const Constant& a, const Constant& b) {
+  if (a.IsFalse() || b.IsFalse())
+    return MakeBoolean(false);
+  if (a.kind == Constant::Null || b.kind == Constant::Null)
+    return MakeNull();
+  return MakeBoolean(true);
+}
+
+static Constant Or(const Constant& a, const Constant& b) {
+  if (a.IsTrue() || b.IsTrue())
+    return MakeBoolean(true);
+  if (a.kind == Constant::Null || b.kind == Constant::Null)
+    return MakeNull();
+  return MakeBoolean(false);
+}
+
+static Constant Arithmetic(const cypher_operator_t* op, const Constant& a, const Constant& b) {
+  if (a.kind == Constant::Null || b.kind == Constant::Null)
+    return MakeNull();
+  if (op == CYPHER_OP_PLUS && a.kind == Constant::String && b.kind == Constant::String)
+    return MakeString(a.string + b.string);
+  if (!IsNumber(a) || !IsNumber(b))
+    return Constant();
+
+  if (op == CYPHER_OP_POW)
+    return MakeFloat(pow(Number(a), Number(b)));
+
+  if (a.kind == Constant::Float || b.kind == Constant::Float) {
+    auto x = Number(a), y = Number(b);
+    if (op == CYPHER_OP_PLUS)
+      return MakeFloat(x + y);
+    if (op == CYPHER_OP_MINUS)
+      return MakeFloat(x - y);
+    if (op == CYPHER_OP_MULT)
+      return MakeFloat(x * y);
+    if (op == CYPHER_OP_DIV && y != 0)
+      return MakeFloat(x / y);
+    if (op == CYPHER_OP_MOD && y != 0)
+      return MakeFloat(fmod(x, y));
+    return Constant();
+  }
+
+  int64_t x = a.integer, y = b.integer, result;
+  if (op == CYPHER_OP_PLUS && !__builtin_add_overflow(x, y, &result))
+    return MakeInteger(result);
+  if (op == CYPHER_OP_MINUS && !__builtin_sub_overflow(x, y, &result))
+    return MakeInteger(result);
+  if (op == CYPHER_OP_MULT && !__builtin_mul_overflow(x, y, &result))
+    return MakeInteger(result);
+  // Integer division truncates, as in Cypher.
+  if (op == CYPHER_OP_DIV && y != 0 && !(x == INT64_MIN && y == -1))
+    return MakeInteger(x / y);
+  if (op == CYPHER_OP_MOD && y != 0)
+    return MakeInteger(y == -1 ? 0 : x % y);
+  return Constant();
+}
+
+static Constant StringPredicate(const cypher_operator_t* op, const Constant& a, const Constant& b) {
+  if (a.kind != Constant::String || b.kind != Constant::String)
+    return MakeNull();
+
+  auto& text = a.string;
+  auto& part = b.string;
+  if (op == CYPHER_OP_STARTS_WITH)
+    return MakeBoolean(text.compare(0, part.length(), part) == 0);
+  if (op == CYPHER_OP_ENDS_WITH)
+    return MakeBoolean(text.length() >= part.length()
+                       && text.compare(text.length() - part.length(), part.length(), part) == 0);
+  return MakeBoolean(text.find(part) != std::string::npos);
+}
+
+// Value of every node but literals and operators, which are not looked up.
+static const Constant unknown;
+
+const Constant& ConstantFolder::Evaluate(const cypher_astnode_t* node) {
+  auto type = cypher_astnode_type(node);
+  if (!IsLiteral(node) && type != CYPHER_AST_UNARY_OPERATOR && type != CYPHER_AST_BINARY_OPERATOR
+      && type != CYPHER_AST_COMPARISON)
+    return unknown;
+
+  auto found = values.find(node);
+  if (found != values.end())
+    return found->second;
+
+  auto value = Compute(node);
+  return values[node] = std::move(value);
+}
+
+bool ConstantFolder::IsLiteral(const cypher_astnode_t* node) {
+  auto type = cypher_astnode_type(node);
+  return type == CYPHER_AST_INTEGER || type == CYPHER_AST_FLOAT || type == CYPHER_AST_STRING
+      || type == CYPHER_AST_TRUE || type == CYPHER_AST_FALSE || type == CYPHER_AST_NULL;
+}
+
+Constant ConstantFolder::Compute(const cypher_astnode_t* node) {
+  auto type = cypher_astnode_type(node);
+  if (type == CYPHER_AST_INTEGER) {
+    // Base 0 also reads the hexadecimal and octal literals of cypher.
+    auto str = cypher_ast_integer_get_valuestr(node);
+    char* end;
+    errno = 0;
+    auto integer = str ? strtoll(str, &end, 0) : 0;
+    if (!str || end == str || errno == ERANGE)
+      return Constant();
+    return MakeInteger(integer);
+  }
+  if (type == CYPHER_AST_FLOAT) {
+    auto str = cypher_ast_float_get_valuestr(node);
+    return str ? MakeFloat(strtod(str, NULL)) : Constant();
+  }
+  if (type == CYPHER_AST_STRING)
+    return MakeString(cypher_ast_string_get_value(node));
+  if (type == CYPHER_AST_TRUE || type == CYPHER_AST_FALSE)
+    return MakeBoolean(type == CYPHER_AST_TRUE);
+  if (type == CYPHER_AST_NULL)
+    return MakeNull();
+
+  if (type == CYPHER_AST_UNARY_OPERATOR)
+    return Unary(cypher_ast_unary_operator_get_operator(node), Evaluate(cypher_ast_unary_operator_get_argument(node)));
+
+  if (type == CYPHER_AST_BINARY_OPERATOR) {
+    auto op = cypher_ast_binary_operator_get_operator(node);
+    auto& a = Evaluate(cypher_ast_binary_operator_get_argument1(node));
+    if (op == CYPHER_OP_IN)
+      return In(a, cypher_ast_binary_operator_get_argument2(node));
+    return Binary(op, a, Evaluate(cypher_ast_binary_operator_get_argument2(node)));
+  }
+
+  // Chained comparisons, as a < b < c, hold when each of them does.
+  if (type == CYPHER_AST_COMPARISON) {
+    auto value = MakeBoolean(true);
+    for (unsigned int i = 0; i < cypher_ast_comparison_get_length(node); i++) {
+      auto comparison = Binary(cypher_ast_comparison_get_operator(node, i),
+                               Evaluate(cypher_ast_comparison_get_argument(node, i)),
+                               Evaluate(cypher_ast_comparison_get_argument(node, i + 1)));
+      if (!comparison.Known())
+        return Constant();
+      value = And(value, comparison);
+    }
+    return value;
+  }
+
+  return Constant();
+}
+
+Constant ConstantFolder::Unary(const cypher_operator_t* op, const Constant& arg) {
+  if (!arg.Known())
+    return Constant();
+
+  if (op == CYPHER_OP_IS_NULL || op == CYPHER_OP_IS_NOT_NULL)
+    return MakeBoolean((arg.kind == Constant::Null) == (op == CYPHER_OP_IS_NULL));
+  if (arg.kind == Constant::Null)
+    return MakeNull();
+  if (op == CYPHER_OP_NOT && arg.kind == Constant::Boolean)
+    return MakeBoolean(!arg.boolean);
+  if (op == CYPHER_OP_UNARY_PLUS && IsNumber(arg))
+    return arg;
+  if (op == CYPHER_OP_UNARY_MINUS && arg.kind == Constant::Float)
+    return MakeFloat(-arg.number);
+  if (op == CYPHER_OP_UNARY_MINUS && arg.kind == Constant::Integer && arg.integer != INT64_MIN)
+    return MakeInteger(-arg.integer);
+  return Constant();
+}
+
+Constant ConstantFolder::Binary(const cypher_operator_t* op, const Constant& a, const Constant& b) {
+  if (!a.Known() || !b.Known())
+    return Constant();
+
+  if (op == CYPHER_OP_AND || op == CYPHER_OP_OR || op == CYPHER_OP_XOR) {
+    if (!IsLogical(a) || !IsLogical(b))
+      return Constant();
+    if (op == CYPHER_OP_AND)
+      return And(a, b);
+    if (op == CYPHER_OP_OR)
+      return Or(a, b);
+    if (a.kind == Constant::Null || b.kind == Constant::Null)
+      return MakeNull();
+    return MakeBoolean(a.boolean != b.boolean);
+  }
+
+  if (op == CYPHER_OP_PLUS || op == CYPHER_OP_MINUS || op == CYPHER_OP_MULT || op == CYPHER_OP_DIV
+      || op == CYPHER_OP_MOD || op == CYPHER_OP_POW)
+    return Arithmetic(op, a, b);
+
+  if (op == CYPHER_OP_STARTS_WITH || op == CYPHER_OP_ENDS_WITH || op == CYPHER_OP_CONTAINS)
+    return StringPredicate(op, a, b);
+
+  if (op == CYPHER_OP_EQUAL || op == CYPHER_OP_NEQUAL) {
+    auto equal = Equal(a, b);
+    if (op == CYPHER_OP_NEQUAL && equal.kind == Constant::Boolean)
+      equal.boolean = !equal.boolean;
+    return equal;
+  }
+
+  if (op == CYPHER_OP_LT || op == CYPHER_OP_GT || op == CYPHER_OP_LTE || op == CYPHER_OP_GTE) {
+    auto order = Order(a, b);
+    if (order.kind == Constant::Null)
+      return order;
+    auto sign = order.integer;
+    if (op == CYPHER_OP_LT)
+      return MakeBoolean(sign < 0);
+    if (op == CYPHER_OP_GT)
+      return MakeBoolean(sign > 0);
+    if (op == CYPHER_OP_LTE)
+      return MakeBoolean(sign <= 0);
+    return MakeBoolean(sign >= 0);
+  }
+
+  return Constant();
+}
+
+// Membership in a literal list of constants. A null element, or a null value tested
+// against a list that is not empty, makes a missing match null rather than false.
+Constant ConstantFolder::In(const Constant& value, const cypher_astnode_t* list) {
+  if (!value.Known() || cypher_astnode_type(list) != CYPHER_AST_COLLECTION)
+    return Constant();
+
+  auto length = cypher_ast_collection_length(list);
+  bool unknown = false;
+  for (unsigned int i = 0; i < length; i++) {
+    auto& element = Evaluate(cypher_ast_collection_get(list, i));
+    if (element.kind != Constant::Null && !IsNumber(element) && element.kind != Constant::Boolean
+        && element.kind != Constant::String)
+      return Constant();
+
+    auto equal = Equal(value, element);
+    if (equal.IsTrue())
+      return equal;
+    unknown = unknown || equal.kind == Constant::Null;
+  }
+  return unknown ? MakeNull() : MakeBoolean(false);
+}
+
+// Whether an expression is sure to be a boolean or null, so that NOT NOT x, x AND true and
+// x OR false equal x. For other values, as strings or integers, Cypher fails on them instead.
+static bool IsBoolean(const cypher_astnode_t* node) {
+  auto type = cypher_astnode_type(node);
+  if (type == CYPHER_AST_TRUE || type == CYPHER_AST_FALSE || type == CYPHER_AST_COMPARISON
+      || type == CYPHER_AST_LABELS_OPERATOR)
+    return true;
+  if (type == CYPHER_AST_UNARY_OPERATOR) {
+    auto op = cypher_ast_unary_operator_get_operator(node);
+    return op == CYPHER_OP_NOT || op == CYPHER_OP_IS_NULL || op == CYPHER_OP_IS_NOT_NULL;
+  }
+  if (type == CYPHER_AST_BINARY_OPERATOR) {
+    auto op = cypher_ast_binary_operator_get_operator(node);
+    return op == CYPHER_OP_AND || op == CYPHER_OP_OR || op == CYPHER_OP_XOR || op == CYPHER_OP_EQUAL
+        || op == CYPHER_OP_NEQUAL || op == CYPHER_OP_LT || op == CYPHER_OP_GT || op == CYPHER_OP_LTE
+        || op == CYPHER_OP_GTE || op == CYPHER_OP_IN || op == CYPHER_OP_STARTS_WITH
+        || op == CYPHER_OP_ENDS_WITH || op == CYPHER_OP_CONTAINS || op == CYPHER_OP_REGEX;
+  }
+  return false;
+}
+
+const cypher_astnode_t* ConstantFolder::Simplify(const cypher_astnode_t* node) {
+  for (;;) {
+    auto type = cypher_astnode_type(node);
+    if (type == CYPHER_AST_UNARY_OPERATOR && cypher_ast_unary_operator_get_operator(node) == CYPHER_OP_NOT) {
+      auto arg = cypher_ast_unary_operator_get_argument(node);
+      if (cypher_astnode_type(arg) == CYPHER_AST_UNARY_OPERATOR
+          && cypher_ast_unary_operator_get_operator(arg) == CYPHER_OP_NOT
+          && IsBoolean(cypher_ast_unary_operator_get_argument(arg))) {
+        node = cypher_ast_unary_operator_get_argument(arg);
+        continue;
+      }
+    }
+    else if (type == CYPHER_AST_BINARY_OPERATOR) {
+      auto op = cypher_ast_binary_operator_get_operator(node);
+      auto arg1 = cypher_ast_binary_operator_get_argument1(node);
+      auto arg2 = cypher_ast_binary_operator_get_argument2(node);
+      // Operands that leave the other one as it is.
+      if (((op == CYPHER_OP_AND && Evaluate(arg1).IsTrue()) || (op == CYPHER_OP_OR && Evaluate(arg1).IsFalse()))
+          && IsBoolean(arg2)) {
+        node = arg2;
+        continue;
+      }
+      if (((op == CYPHER_OP_AND && Evaluate(arg2).IsTrue()) || (op == CYPHER_OP_OR && Evaluate(arg2).IsFalse()))
+          && IsBoolean(arg1)) {
+        node = arg1;
+        continue;
+      }
+    }
+    return node;
+  }
+}
+
+// True constants count too, as predicates always holding are left out. That may name some
+// columns which would have been written as parsed, which only costs fingerprint sharing.
+bool ConstantFolder::Rewrites(const cypher_astnode_t* node) {
+  auto& value = Evaluate(node);
+  if ((value.Known() && (!IsLiteral(node) || value.IsTrue())) || Simplify(node) != node || SingleElementIn(node))
+    return true;
+  for (unsigned int i = 0; i < cypher_astnode_nchildren(node); i++) {
+    if (Rewrites(cypher_astnode_get_child(node, i)))
+      return true;
+  }
+  return false;
+}
+
+const cypher_astnode_t* ConstantFolder::SingleElementIn(const cypher_astnode_t* node) {
+  if (cypher_astnode_type(node) != CYPHER_AST_BINARY_OPERATOR
+      || cypher_ast_binary_operator_get_operator(node) != CYPHER_OP_IN)
+    return NULL;
+
+  auto list = cypher_ast_binary_operator_get_argument2(node);
+  if (cypher_astnode_type(list) != CYPHER_AST_COLLECTION || cypher_ast_collection_length(list) != 1)
+    return NULL;
+  return cypher_ast_collection_get(list, 0);
+}
@@ -0,0 +1,51 @@
+#ifndef __NORMALIZE_HPP__
+#define __NORMALIZE_HPP__
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <cypher-parser.h>
+
+// Value of an expression known from the query text alone.
+struct Constant {
+  enum Kind { Unknown, Null, Boolean, Integer, Float, String };
+
+  Kind kind = Unknown;
+  bool boolean = false;
+  int64_t integer = 0;
+  double number = 0;
+  std::string string;
+
+  bool Known() const { return kind != Unknown; }
+  bool IsTrue() const { return kind == Boolean && boolean; }
+  bool IsFalse() const { return kind == Boolean && !boolean; }
+};
+
+// Folds the operators of constant expressions as NodeBin walks the AST, with the
+// normalize option. Arithmetic follows Cypher: integers stay integers unless mixed with
+// floats, and null propagates. Expressions Cypher would fail on, as integer overflow or
+// division by zero, are not folded, so the error is still raised when the query runs.
+// One folder is made per parse result.
+class ConstantFolder {
+public:
+  // Value of an expression, Unknown when it depends on variables, parameters or functions.
+  const Constant& Evaluate(const cypher_astnode_t* node);
+  // Expression to write instead of a node, as x for NOT NOT x, x AND true or x OR false
+  // when x is a comparison, a predicate or a boolean literal.
+  const cypher_astnode_t* Simplify(const cypher_astnode_t* node);
+  // Element of the one element list of x IN [e], written as x = e instead. NULL otherwise.
+  static const cypher_astnode_t* SingleElementIn(const cypher_astnode_t* node);
+  // Whether a node or any node below it is written otherwise than parsed.
+  bool Rewrites(const cypher_astnode_t* node);
+  static bool IsLiteral(const cypher_astnode_t* node);
+
+private:
+  Constant Compute(const cypher_astnode_t* node);
+  Constant Unary(const cypher_operator_t* op, const Constant& arg);
+  Constant Binary(const cypher_operator_t* op, const Constant& a, const Constant& b);
+  Constant In(const Constant& value, const cypher_astnode_t* list);
+
+  std::unordered_map<const cypher_astnode_t*, Constant> values;
+};
+
+#endif //__NORMALIZE_HPP__
@@ -1,12 +1,27 @@
 #include "parser.hpp"
 #include <iostream>
 #include <exception>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
 #include "memstream/memstream.h"
-#include "fmemopen/fmemopen.h"
-
-const std::string GetJsonText(const rapidjson::Value& doc)
+#include "names.hpp"
+#include "lint.hpp"
+#include "normalize.hpp"
+#include "fingerprint.hpp"
+#include "visit.hpp"
+#include "selector.hpp"
+#include "sink.hpp"
+
+std::string NodeBin::GetJsonText(const rapidjson::Value& doc)
 {
   rapidjson::StringBuffer buffer;
   buffer.Clear();
@@ -17,35 +32,143 @@ const std::string GetJsonText(const rapidjson::Value& doc)
   return std::string(buffer.GetString());
 }
 
+// Initialized when the library loads, before any thread can ask for it. Ids of these names
+// are published in the compact dictionary, so new names are added at the end.
+static const std::vector<const char*> names = {
+  "accumulator", "actions", "alias", "all", "all-nodes-scan", "all-rels-scan", "alternatives",
+  "and", "any", "apply-all-operator", "apply-operator", "arg", "arg1", "arg2", "args",
+  "ascending", "ast", "binary-operator", "block-comment", "body", "call", "case", "clauses",
+  "collection", "column", "command", "comparison", "contains", "context", "contextOffset",
+  "create", "create-node-prop-constraint", "create-node-prop-index", "create-rel-prop-constraint",
+  "cypher-option", "cypher-option-param", "default", "delete", "detach", "direction",
+  "directives", "distinct", "div", "drop-node-prop-constraint", "drop-node-prop-index",
+  "drop-rel-prop-constraint", "elements", "end", "ends-with", "entries", "eof", "equal", "error",
+  "errors", "eval", "expression", "expressions", "extract", "false", "fieldTerminator", "filter",
+  "float", "for-each", "funcName", "function-name", "greater-than", "greater-than-equal", "hints",
+  "identifier", "identifiers", "ids", "in", "includeExisting", "index-name", "indexName", "init",
+  "integer", "is-not-null", "is-null", "items", "label", "labels", "labels-operator", "length",
+  "less-than", "less-than-equal", "limit", "line", "line-comment", "list-comprehension",
+  "load-csv", "lookup", "map", "map-projection", "map-projection-all-properties",
+  "map-projection-identifier", "map-projection-literal", "map-projection-property", "match",
+  "merge", "merge-properties", "message", "minus", "mod", "mult", "name", "named-path", "nnodes",
+  "node-id-lookup", "node-index-lookup", "node-index-query", "node-pattern", "none", "not",
+  "not-equal", "null", "offset", "on-create", "on-match", "op", "ops", "optional", "options",
+  "or", "order-by", "orderBy", "parameter", "params", "path", "paths", "pattern",
+  "pattern-comprehension", "pattern-path", "plus", "points", "position", "pow", "predicate",
+  "proc-name", "procName", "projection", "projections", "prop-name", "propName", "properties",
+  "property", "property-operator", "query", "range", "reduce", "regex", "rel-id-lookup",
+  "rel-index-lookup", "rel-index-query", "rel-pattern", "relType", "reltype", "reltypes",
+  "remove", "remove-labels", "remove-property", "return", "roots", "selectors", "set",
+  "set-all-properties", "set-labels", "set-property", "shortest-path", "single", "skip",
+  "slice-operator", "sort-item", "start", "starts-with", "statement", "statement-option",
+  "string", "subscript", "subscript-operator", "true", "type", "unary-minus", "unary-operator",
+  "unary-plus", "union", "unique", "unwind", "url", "using-index", "using-join",
+  "using-periodic-commit", "using-scan", "value", "varLength", "version", "with", "withHeaders",
+  "xor", "diagnostics", "rule", "binding", "bindings", "kind",
+  "nodes", "matches", "node", "fingerprint"
+};
+
+const std::vector<const char*>& NodeBin::Names() {
+  return names;
+}
+
+static const NameIndex nameIndex;
+
+// One or two letters from the id, so the keys most often seen are all short.
+static std::vector<std::string> MakeCompactKeys() {
+  static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  const int base = sizeof(letters) - 1;
+  std::vector<std::string> keys;
+  for (int id = 0; id < (int)names.size(); id++) {
+    std::string key;
+    for (int rest = id; rest >= 0; rest = rest / base - 1)
+      key.insert(key.begin(), letters[rest % base]);
+    keys.push_back(key);
+  }
+  return keys;
+}
+
+static const std::vector<std::string> compactKeys = MakeCompactKeys();
+
+const std::vector<std::string>& NodeBin::CompactKeys() {
+  return compactKeys;
+}
+
+std::string NodeBin::KeyName(const char* name, bool compact) {
+  auto id = compact ? nameIndex.Find(name, strlen(name)) : -1;
+  return id != -1 ? compactKeys[id] : name;
+}
+
 unsigned int NodeBin::LoopErrors(const cypher_parse_result_t* parseResult) const {
-  rapidjson::Value nodes(rapidjson::Type::kArrayType);
   auto nErrors = cypher_parse_result_nerrors(parseResult);
+  rapidjson::SizeType count = 0;
 
+  Key("errors");
+  sink.StartArray();
   for (unsigned int i = 0; i < nErrors; i++) {
     auto node = cypher_parse_result_get_error(parseResult, i);
     if (!node)
       continue;
     
-    rapidjson::Value nodeTree(rapidjson::kObjectType);
-    auto bin = NodeBin((const cypher_astnode_t*)node, nodeTree, allocator);
-    auto position = cypher_parse_error_position(node);
-    rapidjson::Value nodeTreePos(rapidjson::kObjectType);
-    auto binPos = NodeBin((const cypher_astnode_t*)node, nodeTreePos, allocator);
-    binPos.AddMember("line", (int)position.line);
-    binPos.AddMember("column", (int)position.column);
-    binPos.AddMember("offset", (int)position.offset);
-    bin.AddMember("position", nodeTreePos);
+    sink.StartObject();
+    auto bin = NodeBin((const cypher_astnode_t*)node, sink, context);
+    auto errorContext = cypher_parse_error_context(node);
+    auto contextOffset = cypher_parse_error_context_offset(node);
+    if (context.options.utf16)
+      contextOffset = Utf16Index::Length(errorContext, contextOffset);
+    bin.AddMemberPosition("position", cypher_parse_error_position(node));
     bin.AddMember("message", std::string(cypher_parse_error_message(node)).c_str());
-    bin.AddMember("context", cypher_parse_error_context(node));
-    bin.AddMember("contextOffset", (int)cypher_parse_error_context_offset(node));
-    nodes.PushBack(nodeTree, allocator);
+    bin.AddMember("context", errorContext);
+    bin.AddMember("contextOffset", (int)contextOffset);
+    sink.EndObject(bin.members);
+    count++;
   }
-  
-  AddMember("errors", nodes);
+  sink.EndArray(count);
 
   return nErrors;
 }
 
+void NodeBin::LoopDiagnostics(const Linter& linter) const {
+  rapidjson::SizeType count = 0;
+
+  Key("diagnostics");
+  sink.StartArray();
+  for (auto& diagnostic : linter.Diagnostics()) {
+    size_t contextOffset;
+    auto diagnosticContext = linter.Context(diagnostic.position, contextOffset);
+    if (context.options.utf16)
+      contextOffset = Utf16Index::Length(diagnosticContext.c_str(), contextOffset);
+
+    sink.StartObject();
+    auto bin = NodeBin(node, sink, context);
+    bin.AddMemberPosition("position", diagnostic.position);
+    bin.AddMember("message", diagnostic.message.c_str());
+    bin.AddMember("context", diagnosticContext.c_str());
+    bin.AddMember("contextOffset", (int)contextOffset);
+    bin.AddMember("rule", Linter::RuleName(diagnostic.rule));
+    sink.EndObject(bin.members);
+    count++;
+  }
+  sink.EndArray(count);
+}
+
+void NodeBin::LoopBindings(const Linter& linter) const {
+  rapidjson::SizeType count = 0;
+
+  Key("bindings");
+  sink.StartArray();
+  for (auto& binding : linter.Resolver()->Bindings()) {
+    sink.StartObject();
+    auto bin = NodeBin(node, sink, context);
+    bin.AddMember("name", binding.name.c_str());
+    bin.AddMember("kind", binding.kind);
+    bin.AddMemberPosition("position", binding.position);
+    sink.EndObject(bin.members);
+    count++;
+  }
+  sink.EndArray(count);
+}
+
 FILE* OpenMemStream(char** bufAddress, size_t* lenAddress) {
 #ifdef TMPFILE_AST
   FILE *stream = tmpfile();
@@ -65,18 +188,6 @@ void ReadStream(FILE *stream, char** bufAddress, size_t* lenAddress) {
 #endif
 }
 
-FILE* FMemOpen(std::string& str) {
-#ifdef TMPFILE_AST
-  FILE *stream = tmpfile();
-  fputs(str.c_str(), stream);
-  fflush(stream);
-  rewind(stream);
-#else
-  FILE *stream = fmemopen((void*)str.c_str(), str.length(), "r");
-#endif
-  return stream;
-}
-
 void NodeBin::GetAst(const cypher_parse_result_t* parseResult, unsigned int width,
                        const struct cypher_parser_colorization *colorization, uint_fast32_t flags, std::string& str) {
   char *buf = NULL;
@@ -92,82 +203,550 @@ void NodeBin::GetAst(const cypher_parse_result_t* parseResult, unsigned int widt
   free(buf);
 }
 
-bool NodeBin::Parse(std::string& json, std::string& query, unsigned int width, bool dumpAst, bool colorize, bool parseOnlyStatements) {
+cypher_parser_config_t* NodeBin::NewConfig(const ParseOptions& options) {
   auto config = cypher_parser_new_config();
-  uint_fast32_t flags = parseOnlyStatements ? CYPHER_PARSE_ONLY_STATEMENTS : 0;
   if (config == NULL) {
     std::cerr << "cypher_parser_new_config" << std::endl;
-    return false; 
+    return NULL;
   }
 
-  auto colorization = cypher_parser_no_colorization;
-  if (colorize) {
-    colorization = cypher_parser_ansi_colorization;
-    cypher_parser_config_set_error_colorization(config, colorization);
-  }
+  if (options.colorize)
+    cypher_parser_config_set_error_colorization(config, cypher_parser_ansi_colorization);
 
-  FILE *stream = FMemOpen(query);
-  auto parseResult = cypher_fparse(stream, NULL, config, flags);
-  if (parseResult == NULL) {
-    fclose(stream);
-    std::cerr << "cypher_parse" << std::endl;
-    return false;
+  return config;
+}
+
+struct cypher_input_position Advance(const struct cypher_input_position& base, const struct cypher_input_position& relative) {
+  return {
+    base.line + relative.line - 1,
+    relative.line == 1 ? base.column + relative.column - 1 : relative.column,
+    base.offset + relative.offset
+  };
+}
+
+// Members left out of fingerprints, as they differ between queries of the same shape.
+static std::vector<std::string> UnhashedKeys(bool compact) {
+  std::vector<std::string> keys;
+  for (auto name : { "range", "binding" }) {
+    keys.push_back(name);
+    if (compact)
+      keys.push_back(compactKeys[nameIndex.Find(name, strlen(name))]);
   }
-  fclose(stream);
+  return keys;
+}
 
-  auto nErrors = cypher_parse_result_nerrors(parseResult);    
+unsigned int NodeBin::WalkResult(ResultSink& sink, const cypher_parse_result_t* parseResult, const WalkContext& context,
+                                 Linter* linter, ConstantFolder* folder) {
+  auto& options = context.options;
+  uint_fast32_t flags = options.parseOnlyStatements ? CYPHER_PARSE_ONLY_STATEMENTS : 0;
+  auto colorization = options.colorize ? cypher_parser_ansi_colorization : cypher_parser_no_colorization;
+  auto nErrors = cypher_parse_result_nerrors(parseResult);
 
   std::string ast;
-  if (!nErrors && dumpAst)
-    GetAst(parseResult, width, colorization, flags, ast);
-  
-  rapidjson::Document document(rapidjson::kObjectType);
-  rapidjson::Value result(rapidjson::kObjectType);
-  auto bin = NodeBin((const cypher_astnode_t*)parseResult, result, document.GetAllocator());
-
+  if (!nErrors && options.dumpAst)
+    GetAst(parseResult, options.width, colorization, flags, ast);
+
+  // Directives are hashed as they are written, with the normalize option.
+  FingerprintSink fingerprint(sink, options.normalize ? UnhashedKeys(options.compact) : std::vector<std::string>());
+  auto& output = options.normalize ? (ResultSink&)fingerprint : sink;
+  auto bin = NodeBin((const cypher_astnode_t*)parseResult, output, context);
+  bin.linter = linter;
+  bin.resolver = linter ? linter->Resolver() : NULL;
+  bin.folder = folder;
+
+  output.StartObject();
   bin.AddMember("eof", (bool)cypher_parse_result_eof(parseResult));
   bin.LoopNodes("roots", (node_counter)cypher_parse_result_nroots, (node_getter)cypher_parse_result_get_root);
+  bin.linter = NULL;
+  fingerprint.HashNextArray();
   bin.LoopNodes("directives", (node_counter)cypher_parse_result_ndirectives, (node_getter)cypher_parse_result_get_directive);
   bin.AddMember("nnodes", (int)cypher_parse_result_nnodes(parseResult));
   bin.LoopErrors(parseResult);
-  if (nErrors && dumpAst)
-    GetAst(parseResult, width, colorization, flags, ast);
-
-  if (dumpAst)
+  if (linter)
+    bin.LoopDiagnostics(*linter);
+  if (linter && options.scopes)
+    bin.LoopBindings(*linter);
+  if (options.normalize)
+    bin.AddMember("fingerprint", FingerprintSink::Text(fingerprint.Fingerprint()).c_str());
+  if (nErrors && options.dumpAst)
+    GetAst(parseResult, options.width, colorization, flags, ast);
+
+  if (options.dumpAst)
     bin.AddMember("ast", ast.c_str());
-  
+  output.EndObject(bin.members);
+
+  return nErrors;
+}
+
+// Matching nodes are found depth first in source order. The walk goes on below them, so a
+// match nested in another one is written again as a node of its own.
+unsigned int NodeBin::WalkMatches(ResultSink& sink, const cypher_parse_result_t* parseResult, const WalkContext& context,
+                                  const NodeTypeSet& types) {
+  auto bin = NodeBin((const cypher_astnode_t*)parseResult, sink, context);
+  std::vector<const cypher_astnode_t*> stack;
+  for (unsigned int i = cypher_parse_result_nroots(parseResult); i > 0; i--)
+    stack.push_back(cypher_parse_result_get_root(parseResult, i - 1));
+
+  sink.StartObject();
+  bin.Key("nodes");
+  sink.StartArray();
+  rapidjson::SizeType count = 0;
+  while (!stack.empty()) {
+    auto node = stack.back();
+    stack.pop_back();
+    if (types.Contains(cypher_astnode_type(node))) {
+      bin.WriteNode(node);
+      count++;
+    }
+    for (unsigned int i = cypher_astnode_nchildren(node); i > 0; i--)
+      stack.push_back(cypher_astnode_get_child(node, i - 1));
+  }
+  sink.EndArray(count);
+  auto nErrors = bin.LoopErrors(parseResult);
+  sink.EndObject(bin.members);
+
+  return nErrors;
+}
+
+// Selectors are matched against the path of every node, so each match is written once
+// however many selectors match it.
+unsigned int NodeBin::WalkSelected(ResultSink& sink, const cypher_parse_result_t* parseResult, const WalkContext& context,
+                                   const std::vector<std::shared_ptr<const Selector>>& selectors) {
+  auto bin = NodeBin((const cypher_astnode_t*)parseResult, sink, context);
+  // Nodes still to visit, with their depth.
+  std::vector<std::pair<const cypher_astnode_t*, size_t>> stack;
+  std::vector<const cypher_astnode_t*> path;
+  std::vector<int> matched;
+  for (unsigned int i = cypher_parse_result_nroots(parseResult); i > 0; i--)
+    stack.emplace_back(cypher_parse_result_get_root(parseResult, i - 1), 0);
+
+  sink.StartObject();
+  bin.Key("matches");
+  sink.StartArray();
+  rapidjson::SizeType count = 0;
+  while (!stack.empty()) {
+    auto node = stack.back().first;
+    path.resize(stack.back().second);
+    path.push_back(node);
+    stack.pop_back();
+
+    matched.clear();
+    for (size_t i = 0; i < selectors.size(); i++) {
+      if (selectors[i]->Matches(path))
+        matched.push_back((int)i);
+    }
+    if (!matched.empty()) {
+      sink.StartObject();
+      auto match = NodeBin(node, sink, context);
+      match.Key("node");
+      match.WriteNode(node);
+      match.Key("path");
+      sink.StartArray();
+      for (auto ancestor : path) {
+        auto type = cypher_astnode_type(ancestor);
+        auto name = NodeTypeName(type);
+        if (!name)
+          name = cypher_astnode_typestr(type);
+        sink.String(name, (rapidjson::SizeType)strlen(name), true);
+      }
+      sink.EndArray((rapidjson::SizeType)path.size());
+      match.Key("selectors");
+      sink.StartArray();
+      for (auto selector : matched)
+        sink.Int(selector);
+      sink.EndArray((rapidjson::SizeType)matched.size());
+      sink.EndObject(match.members);
+      count++;
+    }
+
+    for (unsigned int i = cypher_astnode_nchildren(node); i > 0; i--)
+      stack.emplace_back(cypher_astnode_get_child(node, i - 1), path.size());
+  }
+  sink.EndArray(count);
+  auto nErrors = bin.LoopErrors(parseResult);
+  sink.EndObject(bin.members);
+
+  return nErrors;
+}
+
+bool NodeBin::Visit(ParseTree& tree, const char* query, size_t length, const ParseOptions& options, const NodeTypeSet& types) {
+  return ParseAndWalk(tree, query, length, options, [&](ResultSink& sink, const cypher_parse_result_t* parseResult,
+                                                        const WalkContext& context) {
+    return WalkMatches(sink, parseResult, context, types);
+  });
+}
+
+bool NodeBin::Select(ParseTree& tree, const char* query, size_t length, const ParseOptions& options,
+                     const std::vector<std::shared_ptr<const Selector>>& selectors) {
+  return ParseAndWalk(tree, query, length, options, [&](ResultSink& sink, const cypher_parse_result_t* parseResult,
+                                                        const WalkContext& context) {
+    return WalkSelected(sink, parseResult, context, selectors);
+  });
+}
+
+// Parses without the parse result layout, for walks writing only parts of the AST.
+bool NodeBin::ParseAndWalk(ParseTree& tree, const char* query, size_t length, const ParseOptions& options,
+                           const result_walker& walk) {
+  WalkContext context(options, query);
+  if (options.utf16)
+    context.index.Build(query, length);
+
+  auto config = options.config ? options.config : NewConfig(options);
+  if (config == NULL)
+    return false;
+
+  uint_fast32_t flags = options.parseOnlyStatements ? CYPHER_PARSE_ONLY_STATEMENTS : 0;
+  auto parseResult = cypher_uparse(query, length, NULL, config, flags);
+  unsigned int nErrors = 0;
+  if (parseResult == NULL)
+    std::cerr << "cypher_uparse" << std::endl;
+  else {
+    auto generate = [&](rapidjson::Document& handler) {
+      HandlerSink<rapidjson::Document> sink(handler);
+      nErrors = walk(sink, parseResult, context);
+      return true;
+    };
+    tree.document.Populate(generate);
+    cypher_parse_result_free(parseResult);
+  }
+
+  if (config != options.config)
+    cypher_parser_config_free(config);
+  return tree.document.IsObject() && !nErrors;
+}
+
+bool NodeBin::Parse(std::string& json, const char* query, size_t length, const ParseOptions& options) {
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  HandlerSink<rapidjson::Writer<rapidjson::StringBuffer>> sink(writer);
+  auto succeeded = Parse(sink, query, length, options);
+  if (writer.IsComplete())
+    json.assign(buffer.GetString(), buffer.GetSize());
+  return succeeded;
+}
+
+// Sequential parses are written to the sink as they are walked. Parallel chunks are walked
+// into documents on their own threads first, and the stitched result replayed into the sink.
+bool NodeBin::Parse(ResultSink& sink, const char* query, size_t length, const ParseOptions& options) {
+  WalkContext context(options, query);
+  if (options.utf16)
+    context.index.Build(query, length);
+
+  if (options.threads > 1) {
+    ParseTree tree;
+    auto succeeded = ParseParallel(tree, query, length, context);
+    if (tree.document.IsObject())
+      tree.document.Accept(sink);
+    return succeeded;
+  }
+
+  unsigned int nErrors = 0;
+  return ParseSequential(sink, query, length, context, nErrors) && !nErrors;
+}
+
+bool NodeBin::Parse(ParseTree& tree, const char* query, size_t length, const ParseOptions& options) {
+  WalkContext context(options, query);
+  if (options.utf16)
+    context.index.Build(query, length);
+
+  if (options.threads > 1)
+    return ParseParallel(tree, query, length, context);
+  return ParseSequential(tree.document, query, length, context);
+}
+
+bool NodeBin::ParseSequential(rapidjson::Document& document, const char* query, size_t length, const WalkContext& context) {
+  unsigned int nErrors = 0;
+  auto generate = [&](rapidjson::Document& handler) {
+    HandlerSink<rapidjson::Document> sink(handler);
+    return ParseSequential(sink, query, length, context, nErrors);
+  };
+  document.Populate(generate);
+  return document.IsObject() && !nErrors;
+}
+
+// Returns whether a result was written, its errors are counted in nErrors.
+bool NodeBin::ParseSequential(ResultSink& sink, const char* query, size_t length, const WalkContext& context,
+                              unsigned int& nErrors) {
+  auto& options = context.options;
+  auto config = options.config ? options.config : NewConfig(options);
+  if (config == NULL)
+    return false;
+
+  auto written = ParseWithConfig(sink, query, length, config, context, nErrors);
+  if (config != options.config)
+    cypher_parser_config_free(config);
+  return written;
+}
+
+bool NodeBin::ParseWithConfig(ResultSink& sink, const char* query, size_t length, cypher_parser_config_t* config,
+                              const WalkContext& context, unsigned int& nErrors, size_t offset) {
+  uint_fast32_t flags = context.options.parseOnlyStatements ? CYPHER_PARSE_ONLY_STATEMENTS : 0;
+  auto parseResult = cypher_uparse(query, length, NULL, config, flags);
+  if (parseResult == NULL) {
+    std::cerr << "cypher_uparse" << std::endl;
+    return false;
+  }
+
+  auto& options = context.options;
+  Linter linter(options.lint, options.schema.get(), options.scopes, query, length, offset);
+  ConstantFolder folder;
+  nErrors = WalkResult(sink, parseResult, context, options.lint || options.schema || options.scopes ? &linter : NULL,
+                       options.normalize ? &folder : NULL);
   cypher_parse_result_free(parseResult);
+  return true;
+}
+
+struct ChunkResult {
+  const char* data;
+  size_t length;
+  struct cypher_input_position position;
+  rapidjson::Document* document;
+  unsigned int nErrors;
+  bool succeeded;
+};
+
+void NodeBin::ParseChunk(ChunkResult& chunk, const WalkContext& context) {
+  auto config = NewConfig(context.options);
+  if (config == NULL)
+    return;
+
+  cypher_parser_config_set_initial_position(config, chunk.position);
+  auto generate = [&](rapidjson::Document& handler) {
+    HandlerSink<rapidjson::Document> sink(handler);
+    return ParseWithConfig(sink, chunk.data, chunk.length, config, context, chunk.nErrors, chunk.position.offset);
+  };
+  chunk.document->Populate(generate);
+  chunk.succeeded = chunk.document->IsObject();
+
   cypher_parser_config_free(config);
+}
 
-  json = GetJsonText(result);
+void MoveElements(rapidjson::Value& from, rapidjson::Value& to, rapidjson::Document::AllocatorType& allocator) {
+  for (auto& element : from.GetArray())
+    to.PushBack(element, allocator);
+}
+
+bool NodeBin::ParseParallel(ParseTree& tree, const char* query, size_t length, const WalkContext& context) {
+  auto& options = context.options;
+  std::vector<QuerySegment> segments;
+  if (!Split(segments, query, length, options.parseOnlyStatements))
+    return false;
+
+  if (segments.size() < 2)
+    return ParseSequential(tree.document, query, length, context);
+
+  // Group consecutive statements in a few chunks per thread of roughly equal size. Each chunk
+  // starts at its first statement and ends where the next one starts, so separators and
+  // comments are parsed too, and positions are relative to the whole query.
+  size_t nChunks = std::min(segments.size(), (size_t)options.threads * 4);
+  size_t chunkSize = length / nChunks + 1;
+  std::vector<ChunkResult> chunks(nChunks);
+  size_t start = 0;
+  struct cypher_input_position position = { 1, 1, 0 };
+  nChunks = 0;
+  for (size_t i = 1; i <= segments.size(); i++) {
+    size_t end = i < segments.size() ? segments[i].start : length;
+    if (end - start < chunkSize && i < segments.size())
+      continue;
+
+    auto& chunk = chunks[nChunks++];
+    chunk.data = query + start;
+    chunk.length = end - start;
+    chunk.position = position;
+    chunk.succeeded = false;
+    if (i < segments.size()) {
+      start = end;
+      position = { segments[i].line, segments[i].column, segments[i].start };
+    }
+  }
+  chunks.resize(nChunks);
+  tree.chunks.resize(nChunks);
+  for (size_t i = 0; i < nChunks; i++)
+    chunks[i].document = &tree.chunks[i];
+
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    for (size_t i = next++; i < chunks.size(); i = next++)
+      ParseChunk(chunks[i], context);
+  };
+  std::vector<std::thread> pool;
+  for (unsigned int i = 1; i < std::min((size_t)options.threads, chunks.size()); i++)
+    pool.emplace_back(worker);
+  worker();
+  for (auto& thread : pool)
+    thread.join();
+
+  // Stitch the chunk results back in statement order. Values are moved, not copied,
+  // so the chunk documents are kept in the tree.
+  auto& allocator = tree.document.GetAllocator();
+  rapidjson::Value roots(rapidjson::kArrayType);
+  rapidjson::Value directives(rapidjson::kArrayType);
+  rapidjson::Value errors(rapidjson::kArrayType);
+  rapidjson::Value diagnostics(rapidjson::kArrayType);
+  rapidjson::Value bindings(rapidjson::kArrayType);
+  int nnodes = 0;
+  unsigned int nErrors = 0;
+  uint64_t fingerprint = 0;
+  std::string ast;
+
+  for (auto& chunk : chunks) {
+    if (!chunk.succeeded)
+      return false;
+
+    auto& result = *chunk.document;
+    if (options.normalize)
+      fingerprint = FingerprintSink::Combine(fingerprint, FingerprintSink::Read(result["fingerprint"].GetString()),
+                                             result["directives"].Size());
+    MoveElements(result["roots"], roots, allocator);
+    MoveElements(result["directives"], directives, allocator);
+    MoveElements(result["errors"], errors, allocator);
+    if (options.lint || options.schema || options.scopes)
+      MoveElements(result["diagnostics"], diagnostics, allocator);
+    if (options.scopes)
+      MoveElements(result["bindings"], bindings, allocator);
+    nnodes += result["nnodes"].GetInt();
+    nErrors += chunk.nErrors;
+    if (options.dumpAst)
+      ast += result["ast"].GetString();
+  }
+
+  auto& document = tree.document;
+  document.SetObject();
+  document.AddMember("eof", (*chunks.back().document)["eof"].GetBool(), allocator);
+  document.AddMember("roots", roots, allocator);
+  document.AddMember("directives", directives, allocator);
+  document.AddMember("nnodes", nnodes, allocator);
+  document.AddMember("errors", errors, allocator);
+  if (options.lint || options.schema || options.scopes)
+    document.AddMember("diagnostics", diagnostics, allocator);
+  if (options.scopes)
+    document.AddMember("bindings", bindings, allocator);
+  if (options.normalize) {
+    rapidjson::Value text(FingerprintSink::Text(fingerprint).c_str(), allocator);
+    document.AddMember("fingerprint", text, allocator);
+  }
+  if (options.dumpAst) {
+    rapidjson::Value text(ast.c_str(), allocator);
+    document.AddMember("ast", text, allocator);
+  }
 
   return nErrors == 0;
 }
 
-NodeBin::NodeBin(const cypher_astnode_t *n, rapidjson::Value& p, rapidjson::Document::AllocatorType& a):
+int AddSegment(void *userdata, const cypher_quick_parse_segment_t *segment) {
+  auto segments = (std::vector<QuerySegment>*)userdata;
+  size_t length;
+  cypher_quick_parse_segment_get_text(segment, &length);
+  if (!length)
+    return 0;
+
+  auto range = cypher_quick_parse_segment_get_range(segment);
+  segments->push_back({ range.start.offset, range.end.offset, range.start.line, range.start.column,
+                        cypher_quick_parse_segment_is_command(segment) });
+  return 0;
+}
+
+bool NodeBin::Split(std::vector<QuerySegment>& segments, const char* query, size_t length, bool parseOnlyStatements) {
+  uint_fast32_t flags = parseOnlyStatements ? CYPHER_PARSE_ONLY_STATEMENTS : 0;
+  if (cypher_quick_uparse(query, length, AddSegment, &segments, flags)) {
+    std::cerr << "cypher_quick_uparse" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Maps a file and hands its text to parse, reading it with the page cache rather than copying it.
+template <class ParseText>
+static bool ParseMapped(const std::string& path, std::string& error, ParseText parse) {
+  auto fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    error = "Could not open file " + path + ".";
+    return false;
+  }
+
+  struct stat status;
+  if (fstat(fd, &status) == -1) {
+    close(fd);
+    error = "Could not stat file " + path + ".";
+    return false;
+  }
+
+  size_t length = (size_t)status.st_size;
+  if (!length) {
+    close(fd);
+    return parse("", 0);
+  }
+
+  auto data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    error = "Could not map file " + path + ".";
+    return false;
+  }
+
+  madvise(data, length, MADV_SEQUENTIAL);
+  auto succeeded = parse((const char*)data, length);
+  munmap(data, length);
+
+  return succeeded;
+}
+
+bool NodeBin::ParseFile(std::string& json, const std::string& path, const ParseOptions& options, std::string& error) {
+  return ParseMapped(path, error, [&](const char* data, size_t length) { return Parse(json, data, length, options); });
+}
+
+bool NodeBin::ParseFile(ParseTree& tree, const std::string& path, const ParseOptions& options, std::string& error) {
+  return ParseMapped(path, error, [&](const char* data, size_t length) { return Parse(tree, data, length, options); });
+}
+
+bool NodeBin::ParseFile(ResultSink& sink, const std::string& path, const ParseOptions& options, std::string& error) {
+  return ParseMapped(path, error, [&](const char* data, size_t length) { return Parse(sink, data, length, options); });
+}
+
+NodeBin::NodeBin(const cypher_astnode_t *n, ResultSink& s, const WalkContext& c, bool compact):
     node(n),
-    parent(p),
-    allocator(a) {}
+    sink(s),
+    context(c),
+    compact(compact),
+    members(0),
+    linter(NULL),
+    resolver(NULL),
+    folder(NULL) {}
+
+// Compact keys live as long as the library, so they are not copied.
+void NodeBin::Key(const char* key) const {
+  members++;
+  if (compact) {
+    auto id = nameIndex.Find(key, strlen(key));
+    if (id != -1) {
+      sink.Key(compactKeys[id].c_str(), (rapidjson::SizeType)compactKeys[id].length(), false);
+      return;
+    }
+  }
+  sink.Key(key, (rapidjson::SizeType)strlen(key), true);
+}
 
 void NodeBin::AddMember(const char* key, const char* value) const {
-  rapidjson::Value k(key, allocator);
-  rapidjson::Value v(value, allocator);
-  parent.AddMember(k, v, allocator);
+  if (compact && value && (!strcmp(key, "type") || !strcmp(key, "op"))) {
+    auto id = nameIndex.Find(value, strlen(value));
+    if (id != -1) {
+      AddMember(key, id);
+      return;
+    }
+  }
+
+  Key(key);
+  sink.String(value, (rapidjson::SizeType)strlen(value), true);
 }
 
 void NodeBin::AddMember(const char* key, int value) const {
-  rapidjson::Value k(key, allocator);
-  parent.AddMember(k, rapidjson::Value().SetInt(value), allocator);
+  Key(key);
+  sink.Int(value);
 }
 
 void NodeBin::AddMember(const char* key, bool value) const {
-  rapidjson::Value k(key, allocator);
-  parent.AddMember(k, rapidjson::Value().SetBool(value), allocator);
-}
-
-void NodeBin::AddMember(const char* key, rapidjson::Value& value) const {
-  rapidjson::Value k(key, allocator);
-  parent.AddMember(k, value, allocator);
+  Key(key);
+  sink.Bool(value);
 }
 
 void NodeBin::AddMemberInt(const char* key, specific_node_getter getter) const {
@@ -186,14 +765,17 @@ void NodeBin::AddMemberInt(const char* key, const cypher_astnode_t* intNode) con
     return;
   }
 
-  try {
-    auto i = atoi(strVal);
-    AddMember(key, i);
-  }
-  catch (const std::exception& e) {
-    std::cerr << "std::stoi exception: " << e.what() << std::endl;
+  // Base 0 also reads the hexadecimal and octal literals of cypher.
+  char* end;
+  errno = 0;
+  auto value = strtoll(strVal, &end, 0);
+  if (end == strVal || errno == ERANGE) {
     AddMemberNull(key);
+    return;
   }
+
+  Key(key);
+  sink.Int64(value);
 }
 
 void NodeBin::AddMemberFloat(const char* key, specific_node_getter getter) const {
@@ -214,9 +796,8 @@ void NodeBin::AddMemberFloat(const char* key, const cypher_astnode_t* floatNode)
 
   try {
     auto ld = strtod(strVal, NULL);
-    rapidjson::Value value;
-    value.SetDouble(ld);
-    AddMember(key, value);
+    Key(key);
+    sink.Double(ld);
   }
   catch (const std::exception& e) {
     std::cerr << "std::stod exception: " << e.what() << std::endl;
@@ -240,76 +821,48 @@ void NodeBin::AddMemberStr(const char* key, specific_node_getter getter) const {
   AddMember(key, strVal);
 }
 
+void NodeBin::AddMemberRange(const char* key) const {
+  auto range = cypher_astnode_range(node);
+  Key(key);
+  sink.StartArray();
+  sink.Uint64(MapOffset(range.start.offset));
+  sink.Uint64(MapOffset(range.end.offset));
+  sink.EndArray(2);
+}
+
+void NodeBin::AddMemberPosition(const char* key, struct cypher_input_position position) const {
+  if (context.options.utf16)
+    position = context.index.Map(position);
+  position = Advance(context.options.position, position);
+
+  Key(key);
+  sink.StartObject();
+  auto bin = NodeBin(node, sink, context);
+  bin.AddMember("line", (int)position.line);
+  bin.AddMember("column", (int)position.column);
+  bin.AddMember("offset", (int)position.offset);
+  sink.EndObject(bin.members);
+}
+
+size_t NodeBin::MapOffset(size_t offset) const {
+  if (context.options.utf16)
+    offset = context.index.Map(offset);
+  return context.options.position.offset + offset;
+}
+
 void NodeBin::AddMemberNull(const char* key) const {
-  rapidjson::Value k(key, allocator);
-  rapidjson::Value v;
-  v.SetNull();
-  parent.AddMember(k, v, allocator);
+  if (compact)
+    return;
+
+  Key(key);
+  sink.Null();
 }
 
 const char* NodeBin::ParseOp(const cypher_operator_t* op) const {
-  if (op == CYPHER_OP_OR)
-    return "or";
-  else if (op == CYPHER_OP_XOR)
-    return "xor";
-  else if (op == CYPHER_OP_AND)
-    return "and";
-  else if (op == CYPHER_OP_NOT)
-    return "not";
-  else if (op == CYPHER_OP_EQUAL)
-    return "equal";
-  else if (op == CYPHER_OP_NEQUAL)
-    return "not-equal";
-  else if (op == CYPHER_OP_LT)
-    return "less-than";
-  else if (op == CYPHER_OP_GT)
-    return "greater-than";
-  else if (op == CYPHER_OP_LTE)
-    return "less-than-equal";
-  else if (op == CYPHER_OP_GTE)
-    return "greater-than-equal";
-  else if (op == CYPHER_OP_PLUS)
-    return "plus";
-  else if (op == CYPHER_OP_MINUS)
-    return "minus";
-  else if (op == CYPHER_OP_MULT)
-    return "mult";
-  else if (op == CYPHER_OP_DIV)
-    return "div";
-  else if (op == CYPHER_OP_MOD)
-    return "mod";
-  else if (op == CYPHER_OP_POW)
-    return "pow";
-  else if (op == CYPHER_OP_UNARY_PLUS)
-    return "unary-plus";
-  else if (op == CYPHER_OP_UNARY_MINUS)
-    return "unary-minus";
-  else if (op == CYPHER_OP_SUBSCRIPT)
-    return "subscript";
-  else if (op == CYPHER_OP_MAP_PROJECTION)
-    return "map-projection";
-  else if (op == CYPHER_OP_REGEX)
-    return "regex";
-  else if (op == CYPHER_OP_IN)
-    return "in";
-  else if (op == CYPHER_OP_STARTS_WITH)
-    return "starts-with";
-  else if (op == CYPHER_OP_ENDS_WITH)
-    return "ends-with";
-  else if (op == CYPHER_OP_CONTAINS)
-    return "contains";
-  else if (op == CYPHER_OP_IS_NULL)
-    return "is-null";
-  else if (op == CYPHER_OP_IS_NOT_NULL)
-    return "is-not-null";
-  else if (op == CYPHER_OP_PROPERTY)
-    return "property";
-  else if (op == CYPHER_OP_LABEL)
-    return "label";
-  else {
+  auto name = OperatorName(op);
+  if (!name)
     std::cerr << "WARNING: Unknown operator" << std::endl;
-    return NULL;
-  }
+  return name;
 }
 
 void NodeBin::AddMemberOp(const char* key, operator_getter getter) const {
@@ -317,29 +870,41 @@ void NodeBin::AddMemberOp(const char* key, operator_getter getter) const {
 }
 
 void NodeBin::LoopOps(const char* name, node_counter counter, op_getter getter) const {
-  rapidjson::Value nodes(rapidjson::Type::kArrayType);
-  for (unsigned int i = 0; i < counter(node); i++) {
-    rapidjson::Value op(ParseOp(getter(node, i)), allocator);
-    nodes.PushBack(op, allocator);
+  auto count = counter(node);
+  if (compact && !count)
+    return;
+
+  Key(name);
+  sink.StartArray();
+  for (unsigned int i = 0; i < count; i++) {
+    auto op = ParseOp(getter(node, i));
+    auto id = compact && op ? nameIndex.Find(op, strlen(op)) : -1;
+    if (id != -1)
+      sink.Int(id);
+    else if (op)
+      sink.String(op, (rapidjson::SizeType)strlen(op), true);
+    else
+      sink.Null();
   }
-  AddMember(name, nodes);
+  sink.EndArray(count);
 }
 
 void NodeBin::LoopNodes(const char* name, unsigned int counter, node_getter getter) const {
-  rapidjson::Value nodes(rapidjson::Type::kArrayType);
+  if (compact && !counter)
+    return;
 
+  rapidjson::SizeType count = 0;
+  Key(name);
+  sink.StartArray();
   for (unsigned int i = 0; i < counter; i++) {
     auto node = getter(this->node, i);
     if (!node)
       continue;
     
-    rapidjson::Value nodeTree(rapidjson::kObjectType);
-    auto bin = NodeBin(node, nodeTree, allocator);
-    bin.WalkNode(0);
-    nodes.PushBack(nodeTree, allocator);
+    WriteNode(node);
+    count++;
   }
-  
-  AddMember(name, nodes);
+  sink.EndArray(count);
 }
 
 void NodeBin::LoopNodes(const char* name, node_counter counter, node_getter getter) const {
@@ -348,9 +913,14 @@ void NodeBin::LoopNodes(const char* name, node_counter counter, node_getter gett
 
 void NodeBin::LoopKeyValuePairs(const char* name, const char* keyName, const char* valueName,
                                 node_counter counter, node_getter keyGetter, node_getter valueGetter) const {
-  rapidjson::Value nodes(rapidjson::Type::kArrayType);
-  
-  for (unsigned int i = 0; i < counter(node); i++) {
+  auto nPairs = counter(node);
+  if (compact && !nPairs)
+    return;
+
+  rapidjson::SizeType count = 0;
+  Key(name);
+  sink.StartArray();
+  for (unsigned int i = 0; i < nPairs; i++) {
     auto key = keyGetter(node, i);
     if (!key)
       continue;
@@ -359,24 +929,106 @@ void NodeBin::LoopKeyValuePairs(const char* name, const char* keyName, const cha
     if (!value)
       continue;
     
-    rapidjson::Value nodeTree(rapidjson::kObjectType);
-    auto bin = NodeBin(node, nodeTree, allocator);
+    sink.StartObject();
+    auto bin = NodeBin(node, sink, context, context.options.compact);
+    bin.linter = linter;
+    bin.resolver = resolver;
+    bin.folder = folder;
     bin.Node(keyName, key);
     bin.Node(valueName, value);
-    nodes.PushBack(nodeTree, allocator);
+    sink.EndObject(bin.members);
+    count++;
   }
-  
-  AddMember(name, nodes);
+  sink.EndArray(count);
 }
 
 void NodeBin::Node(const char* name, const cypher_astnode_t* node) const {
-  if (!node)
+  if (!node) {
+    // Absent children are kept as null members, so nodes of a type always share one shape.
+    if (context.options.fixedShapes)
+      AddMemberNull(name);
     return;
+  }
   
-  rapidjson::Value nodeTree(rapidjson::kObjectType);
-  auto bin = NodeBin(node, nodeTree, allocator);
-  bin.WalkNode(0);
-  AddMember(name, nodeTree);
+  Key(name);
+  WriteNode(node);
+}
+
+// Writes a child node as an object of its own. Folded expressions are written as the
+// literal of their value, without their subtree.
+void NodeBin::WriteNode(const cypher_astnode_t* node) const {
+  if (folder)
+    node = folder->Simplify(node);
+
+  sink.StartObject();
+  auto bin = NodeBin(node, sink, context, context.options.compact);
+  bin.linter = linter;
+  bin.resolver = resolver;
+  bin.folder = folder;
+  if (linter)
+    linter->Enter(node);
+  auto element = folder ? ConstantFolder::SingleElementIn(node) : NULL;
+  if (folder && !ConstantFolder::IsLiteral(node) && folder->Evaluate(node).Known())
+    bin.WriteConstant(folder->Evaluate(node));
+  else if (element)
+    bin.WriteEqual(cypher_ast_binary_operator_get_argument1(node), element);
+  else
+    bin.WalkNode(0);
+  if (linter)
+    linter->Leave(node);
+  sink.EndObject(bin.members);
+}
+
+void NodeBin::WriteConstant(const Constant& value) const {
+  if (value.kind == Constant::Integer) {
+    AddMember("type", "integer");
+    Key("value");
+    sink.Int64(value.integer);
+  }
+  else if (value.kind == Constant::Float) {
+    AddMember("type", "float");
+    Key("value");
+    sink.Double(value.number);
+  }
+  else if (value.kind == Constant::String) {
+    AddMember("type", "string");
+    AddMember("value", value.string.c_str());
+  }
+  else if (value.kind == Constant::Boolean)
+    AddMember("type", value.boolean ? "true" : "false");
+  else
+    AddMember("type", "null");
+  if (context.options.ranges)
+    AddMemberRange("range");
+}
+
+// Writes x IN [e] as the comparison x = e, in the shape WalkComparison gives it.
+void NodeBin::WriteEqual(const cypher_astnode_t* arg1, const cypher_astnode_t* arg2) const {
+  AddMember("type", "comparison");
+  AddMember("length", 1);
+  Key("ops");
+  sink.StartArray();
+  auto id = compact ? nameIndex.Find("equal", 5) : -1;
+  if (id != -1)
+    sink.Int(id);
+  else
+    sink.String("equal", 5, true);
+  sink.EndArray(1);
+  Key("args");
+  sink.StartArray();
+  WriteNode(arg1);
+  WriteNode(arg2);
+  sink.EndArray(2);
+  if (context.options.ranges)
+    AddMemberRange("range");
+}
+
+// WHERE predicates always holding are left out with the normalize option.
+void NodeBin::Predicate(specific_node_getter getter) const {
+  auto predicate = getter(node);
+  if (folder && predicate && folder->Evaluate(predicate).IsTrue())
+    predicate = NULL;
+  Node("predicate", predicate);
 }
 
 void NodeBin::Node(const char* name, specific_node_getter getter) const {
@@ -627,6 +1279,8 @@ void NodeBin::SwitchWalk(cypher_astnode_type_t nodeType) const {
 void NodeBin::WalkNode(int nodeOffset) const {
   auto nodeType = cypher_astnode_type(node);
   SwitchWalk(nodeType);
+  if (context.options.ranges)
+    AddMemberRange("range");
 }
 
 void NodeBin::WalkParameter() const {
@@ -639,7 +1293,7 @@ void NodeBin::WalkMatch() const {
   AddMember("optional", (bool)cypher_ast_match_is_optional(node));
   Node("pattern", cypher_ast_match_get_pattern);
   LoopNodes("hints", cypher_ast_match_nhints, cypher_ast_match_get_hint);
-  Node("predicate", cypher_ast_match_get_predicate);
+  Predicate(cypher_ast_match_get_predicate);
 }
 
 void NodeBin::WalkQuery() const {
@@ -738,7 +1392,7 @@ void NodeBin::WalkLoadCsv() const {
 void NodeBin::WalkStart() const {
   AddMember("type", "start");
   LoopNodes("points", cypher_ast_start_npoints, cypher_ast_start_get_point);
-  Node("predicate", cypher_ast_start_get_predicate);
+  Predicate(cypher_ast_start_get_predicate);
 }
 
 void NodeBin::WalkNodeIndexLookup() const {
@@ -899,7 +1553,7 @@ void NodeBin::WalkWith() const {
   Node("orderBy", cypher_ast_with_get_order_by);
   Node("skip", cypher_ast_with_get_skip);
   Node("limit", cypher_ast_with_get_limit);
-  Node("predicate", cypher_ast_with_get_predicate);
+  Predicate(cypher_ast_with_get_predicate);
 }
 
 void NodeBin::WalkUnwind() const {
@@ -925,10 +1579,26 @@ void NodeBin::WalkReturn() const {
   Node("limit", cypher_ast_return_get_limit);
 }
 
+// Columns without an alias are named after the text of their expression. Folded expressions
+// keep that name as an alias, so the fingerprint tells apart queries with other column names.
 void NodeBin::WalkProjection() const {
   AddMember("type", "projection");
-  Node("expression", cypher_ast_projection_get_expression);
-  Node("alias", cypher_ast_projection_get_alias);
+  auto expression = cypher_ast_projection_get_expression(node);
+  auto alias = cypher_ast_projection_get_alias(node);
+  Node("expression", expression);
+  if (alias || !folder || !expression || !folder->Rewrites(expression)) {
+    Node("alias", alias);
+    return;
+  }
+
+  auto range = cypher_astnode_range(expression);
+  std::string name(context.query + range.start.offset, range.end.offset - range.start.offset);
+  Key("alias");
+  sink.StartObject();
+  auto bin = NodeBin(expression, sink, context, compact);
+  bin.AddMember("type", "identifier");
+  bin.AddMember("name", name.c_str());
+  sink.EndObject(bin.members);
 }
 
 void NodeBin::WalkOrderBy() const {
@@ -1035,7 +1705,7 @@ void NodeBin::WalkListComprehension() const {
   AddMember("type", "list-comprehension");
   Node("identifier", cypher_ast_list_comprehension_get_identifier);
   Node("expression", cypher_ast_list_comprehension_get_expression);
-  Node("predicate", cypher_ast_list_comprehension_get_predicate);
+  Predicate(cypher_ast_list_comprehension_get_predicate);
   Node("eval", cypher_ast_list_comprehension_get_eval);
 }
 
@@ -1043,7 +1713,7 @@ void NodeBin::WalkPatternComprehension() const {
   AddMember("type", "pattern-comprehension");
   Node("identifier", cypher_ast_pattern_comprehension_get_identifier);
   Node("pattern", cypher_ast_pattern_comprehension_get_pattern);
-  Node("predicate", cypher_ast_pattern_comprehension_get_predicate);
+  Predicate(cypher_ast_pattern_comprehension_get_predicate);
   Node("eval", cypher_ast_pattern_comprehension_get_eval);
 }
 
@@ -1114,8 +1784,9 @@ void NodeBin::WalkCollection() const {
 void NodeBin::WalkMap() const {
   AddMember("type", "map");
 
-  rapidjson::Value entries(rapidjson::kObjectType);
-  
+  rapidjson::SizeType count = 0;
+  Key("entries");
+  sink.StartObject();
   for (unsigned int i = 0; i < cypher_ast_map_nentries(node); i++) {
     auto key = cypher_ast_map_get_key(node, i);
     auto value = cypher_ast_map_get_value(node, i);
@@ -1123,21 +1794,27 @@ void NodeBin::WalkMap() const {
     if (!key)
       continue;
 
+    // Entry keys are property names from the query, never compacted.
     auto name = cypher_ast_prop_name_get_value(key);
-    rapidjson::Value valueTree(rapidjson::kObjectType);
-    auto bin = NodeBin(value, valueTree, allocator);
-    bin.WalkNode(0);
-
-    rapidjson::Value k(name, allocator);
-    entries.AddMember(k, valueTree, allocator);
+    sink.Key(name, (rapidjson::SizeType)strlen(name), true);
+    WriteNode(value);
+    count++;
   }
-
-  AddMember("entries", entries);
+  sink.EndObject(count);
 }
 
+// Identifiers refer to their variable by the offset of the identifier binding it.
 void NodeBin::WalkIdentifier() const {
   AddMember("type", "identifier");
   AddMember("name", cypher_ast_identifier_get_name(node));
+  if (!context.options.scopes)
+    return;
+
+  auto binding = resolver ? resolver->Binding(node) : -1;
+  if (binding != -1)
+    AddMember("binding", (int)MapOffset(resolver->Bindings()[binding].position.offset));
+  else
+    AddMemberNull("binding");
 }
 
 void NodeBin::WalkString() const {
@@ -1,15 +1,98 @@
 #ifndef __PARSER_HPP__
 #define __PARSER_HPP__
 
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 #include <cypher-parser.h>
 #include "rapidjson/document.h"
+#include "sink.hpp"
+#include "utf16.hpp"
+
+struct QuerySegment {
+  size_t start;
+  size_t end;
+  unsigned int line;
+  unsigned int column;
+  bool command;
+};
+
+class GraphSchema;
+
+struct ParseOptions {
+  unsigned int width = 0;
+  bool dumpAst = false;
+  bool colorize = false;
+  bool parseOnlyStatements = true;
+  unsigned int threads = 0;
+  bool ranges = false;
+  bool utf16 = false;
+  bool fixedShapes = false;
+  // Short keys, type and operator ids from the compact dictionary, without null members or empty arrays, in AST nodes.
+  bool compact = false;
+  // Bit set of the LintRule values checked during the walk, reported as diagnostics.
+  unsigned int lint = 0;
+  // Labels, relationship types and property keys the query may use, also reported as diagnostics.
+  std::shared_ptr<const GraphSchema> schema;
+  // Binding of every identifier, the variables bound, and unbound or shadowed variables as diagnostics.
+  bool scopes = false;
+  // Folded constant expressions, simplified predicates, and a fingerprint of the directives.
+  bool normalize = false;
+  struct cypher_input_position position = { 1, 1, 0 };
+  // Config shared by sequential parses, owned by a ParserHandle. A new one is made per parse otherwise.
+  cypher_parser_config_t* config = NULL;
+};
+
+struct ChunkResult;
+struct Constant;
+class ConstantFolder;
+class Linter;
+class NodeTypeSet;
+class ScopeResolver;
+class Selector;
+
+struct WalkContext {
+  WalkContext(const ParseOptions& o, const char* q): options(o), query(q) {}
+
+  const ParseOptions& options;
+  // Whole text parsed, which the offsets of node ranges point into.
+  const char* query;
+  Utf16Index index;
+};
+
+// Result tree of a parse. Results stitched from parallel chunks are moved, not copied,
+// and still live in the chunk documents kept alongside.
+struct ParseTree {
+  rapidjson::Document document;
+  std::vector<rapidjson::Document> chunks;
+};
 
 class NodeBin {
 public:
-  NodeBin(const cypher_astnode_t *n, rapidjson::Value& p, rapidjson::Document::AllocatorType& a);
+  NodeBin(const cypher_astnode_t *n, ResultSink& s, const WalkContext& c, bool compact = false);
   void WalkNode(int nodeOffset) const;
-  static bool Parse(std::string& json, std::string& query, unsigned int width, bool dumpAst, bool colorize, bool parseOnlyStatements);
+  static bool Parse(std::string& json, const char* query, size_t length, const ParseOptions& options);
+  static bool Parse(ParseTree& tree, const char* query, size_t length, const ParseOptions& options);
+  static bool Parse(ResultSink& sink, const char* query, size_t length, const ParseOptions& options);
+  static bool ParseFile(std::string& json, const std::string& path, const ParseOptions& options, std::string& error);
+  static bool ParseFile(ParseTree& tree, const std::string& path, const ParseOptions& options, std::string& error);
+  static bool ParseFile(ResultSink& sink, const std::string& path, const ParseOptions& options, std::string& error);
+  static std::string GetJsonText(const rapidjson::Value& value);
+  // Every member name and type value the walk can produce.
+  static const std::vector<const char*>& Names();
+  // Keys of compact results, by the id of the name they stand for.
+  static const std::vector<std::string>& CompactKeys();
+  // Key a member name is written under, with or without the compact option.
+  static std::string KeyName(const char* name, bool compact);
+  static cypher_parser_config_t* NewConfig(const ParseOptions& options);
+  static bool Split(std::vector<QuerySegment>& segments, const char* query, size_t length, bool parseOnlyStatements);
+  // Writes only the nodes of some types, each with its subtree, as the nodes of the result.
+  static bool Visit(ParseTree& tree, const char* query, size_t length, const ParseOptions& options, const NodeTypeSet& types);
+  // Writes the nodes matched by any of some selectors, each with its subtree, the types of
+  // the nodes on its path from the root, and the indices of the selectors matching it.
+  static bool Select(ParseTree& tree, const char* query, size_t length, const ParseOptions& options,
+                     const std::vector<std::shared_ptr<const Selector>>& selectors);
 
 private:
   typedef unsigned int (*node_counter)(const cypher_astnode_t *);
@@ -17,6 +100,7 @@ private:
   typedef const cypher_astnode_t* (*specific_node_getter)(const cypher_astnode_t *);
   typedef const cypher_operator_t* (*operator_getter)(const cypher_astnode_t *);
   typedef const cypher_operator_t* (*op_getter)(const cypher_astnode_t *, unsigned int);
+  typedef std::function<unsigned int(ResultSink&, const cypher_parse_result_t*, const WalkContext&)> result_walker;
 
   void WalkQuery() const;
   void WalkStatement() const;
@@ -120,16 +204,18 @@ private:
   void WalkBlockComment() const;
   void WalkError() const;
 
+  void Key(const char* key) const;
   void AddMember(const char* key, const char* value) const;
   void AddMember(const char* key, int value) const;
   void AddMember(const char* key, bool value) const;
-  void AddMember(const char* key, rapidjson::Value& value) const;
   void AddMemberInt(const char* key, specific_node_getter getter) const;
   void AddMemberInt(const char* key, const cypher_astnode_t* intNode) const;
   void AddMemberFloat(const char* key, specific_node_getter getter) const;
   void AddMemberFloat(const char* key, const cypher_astnode_t* floatNode) const;
   void AddMemberStr(const char* key, specific_node_getter getter) const;
   void AddMemberNull(const char* key) const;
+  void AddMemberRange(const char* key) const;
+  void AddMemberPosition(const char* key, struct cypher_input_position position) const;
   void AddMemberOp(const char* key, operator_getter getter) const;
 
   const char* ParseOp(const cypher_operator_t* op) const;
@@ -140,15 +226,49 @@ private:
   void LoopOps(const char* name, node_counter counter, op_getter getter) const;
   void Node(const char* name, const cypher_astnode_t* node) const;
   void Node(const char* name, specific_node_getter getter) const;
+  void WriteNode(const cypher_astnode_t* node) const;
+  void WriteConstant(const Constant& value) const;
+  void WriteEqual(const cypher_astnode_t* arg1, const cypher_astnode_t* arg2) const;
+  void Predicate(specific_node_getter getter) const;
   void SwitchWalk(cypher_astnode_type_t nodeType) const;
   unsigned int LoopErrors(const cypher_parse_result_t* parseResult) const;
+  void LoopDiagnostics(const Linter& linter) const;
+  void LoopBindings(const Linter& linter) const;
+
+  size_t MapOffset(size_t offset) const;
 
+  static unsigned int WalkResult(ResultSink& sink, const cypher_parse_result_t* parseResult, const WalkContext& context,
+                                 Linter* linter = NULL, ConstantFolder* folder = NULL);
+  static unsigned int WalkMatches(ResultSink& sink, const cypher_parse_result_t* parseResult, const WalkContext& context,
+                                  const NodeTypeSet& types);
+  static unsigned int WalkSelected(ResultSink& sink, const cypher_parse_result_t* parseResult, const WalkContext& context,
+                                   const std::vector<std::shared_ptr<const Selector>>& selectors);
+  static bool ParseAndWalk(ParseTree& tree, const char* query, size_t length, const ParseOptions& options,
+                           const result_walker& walk);
+  static bool ParseSequential(rapidjson::Document& document, const char* query, size_t length, const WalkContext& context);
+  static bool ParseSequential(ResultSink& sink, const char* query, size_t length, const WalkContext& context,
+                              unsigned int& nErrors);
+  static bool ParseWithConfig(ResultSink& sink, const char* query, size_t length, cypher_parser_config_t* config,
+                              const WalkContext& context, unsigned int& nErrors, size_t offset = 0);
+  static bool ParseParallel(ParseTree& tree, const char* query, size_t length, const WalkContext& context);
+  static void ParseChunk(ChunkResult& chunk, const WalkContext& context);
   static void GetAst(const cypher_parse_result_t* parseResult, unsigned int width,
                        const struct cypher_parser_colorization *colorization, uint_fast32_t flags, std::string& str);
   
   const cypher_astnode_t *node;
-  rapidjson::Value& parent;
-  rapidjson::Document::AllocatorType& allocator;
+  ResultSink& sink;
+  const WalkContext& context;
+  // Set for AST nodes with the compact option, not for the result and its errors.
+  bool compact;
+  // Members written so far to the object of this node.
+  mutable rapidjson::SizeType members;
+  // Told of every node entered and left, with the lint option. Only the roots are walked
+  // with it, directives are the same statements and would be checked twice.
+  Linter* linter;
+  // Bindings of the identifiers resolved by the linter, for every walk of them.
+  const ScopeResolver* resolver;
+  // Folds the expressions written, with the normalize option.
+  ConstantFolder* folder;
 };
 
 #endif //__PARSER_HPP__
\ No newline at end of file
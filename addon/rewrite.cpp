@@ -0,0 +1,226 @@
+#include "rewrite.hpp"
+#include <algorithm>
+#include <cctype>
+#include <utility>
+#include "ast.hpp"
+#include "scopes.hpp"
+
+struct TextEdit {
+  size_t start;
+  size_t end;
+  std::string text;
+};
+
+// Names that are not plain identifiers are quoted with backticks.
+static std::string Escape(const std::string& name) {
+  bool plain = !name.empty() && (isalpha((unsigned char)name[0]) || name[0] == '_');
+  for (auto c : name)
+    plain = plain && (isalnum((unsigned char)c) || c == '_');
+  if (plain)
+    return name;
+
+  std::string escaped = "`";
+  for (auto c : name) {
+    escaped += c;
+    if (c == '`')
+      escaped += c;
+  }
+  return escaped + "`";
+}
+
+// End of the last token in some text, scanned from its start so comment markers inside
+// strings and quoted names are not taken for comments.
+static size_t TokenEnd(const char* query, size_t start, size_t end) {
+  size_t last = start;
+  for (size_t i = start; i < end;) {
+    auto c = query[i];
+    if (c == '/' && i + 1 < end && query[i + 1] == '/') {
+      while (i < end && query[i] != '\n')
+        i++;
+    }
+    else if (c == '/' && i + 1 < end && query[i + 1] == '*') {
+      i += 2;
+      while (i + 1 < end && !(query[i] == '*' && query[i + 1] == '/'))
+        i++;
+      i = std::min(i + 2, end);
+    }
+    else if (isspace((unsigned char)c))
+      i++;
+    else if (c == '\'' || c == '"' || c == '`') {
+      // Strings escape with backslashes, names double their backticks, which reads as two names here.
+      for (i++; i < end && query[i] != c; i++) {
+        if (c != '`' && query[i] == '\\')
+          i++;
+      }
+      i = std::min(i + 1, end);
+      last = i;
+    }
+    else
+      last = ++i;
+  }
+  return last;
+}
+
+// Range of a node in the query, without the whitespace and comments node ranges take in
+// after them, so text inserted at its end is not commented out.
+static std::pair<size_t, size_t> TextRange(const char* query, const cypher_astnode_t* node) {
+  auto range = cypher_astnode_range(node);
+  size_t start = range.start.offset, end = range.end.offset;
+  while (start < end && isspace((unsigned char)query[start]))
+    start++;
+  return { start, TokenEnd(query, start, end) };
+}
+
+static bool Selected(const RewriteOperation& operation, const std::vector<const cypher_astnode_t*>& path) {
+  return !operation.selector || operation.selector->Matches(path);
+}
+
+static void AddPredicate(std::vector<TextEdit>& edits, const char* query, const cypher_astnode_t* match,
+                         const std::string& predicate) {
+  auto where = cypher_ast_match_get_predicate(match);
+  if (where) {
+    auto range = TextRange(query, where);
+    edits.push_back({ range.first, range.first, "(" });
+    edits.push_back({ range.second, range.second, ") AND (" + predicate + ")" });
+    return;
+  }
+
+  // WHERE follows the pattern and its hints.
+  auto end = TextRange(query, cypher_ast_match_get_pattern(match)).second;
+  for (unsigned int i = 0; i < cypher_ast_match_nhints(match); i++)
+    end = std::max(end, TextRange(query, cypher_ast_match_get_hint(match, i)).second);
+  edits.push_back({ end, end, " WHERE " + predicate });
+}
+
+static void AddLabel(std::vector<TextEdit>& edits, const char* query, const cypher_astnode_t* nodePattern,
+                     const std::string& label) {
+  auto end = TextRange(query, nodePattern).first + 1;
+  auto identifier = cypher_ast_node_pattern_get_identifier(nodePattern);
+  if (identifier)
+    end = TextRange(query, identifier).second;
+  for (unsigned int i = 0; i < cypher_ast_node_pattern_nlabels(nodePattern); i++) {
+    auto node = cypher_ast_node_pattern_get_label(nodePattern, i);
+    if (label == cypher_ast_label_get_name(node))
+      return;
+    end = std::max(end, TextRange(query, node).second);
+  }
+  edits.push_back({ end, end, ":" + Escape(label) });
+}
+
+// Whether an identifier is the one binding a variable, rather than a reference to it.
+static bool Declares(const ScopeResolver& resolver, int binding, const cypher_astnode_t* identifier) {
+  return binding != -1 && resolver.Bindings()[binding].position.offset == cypher_astnode_range(identifier).start.offset;
+}
+
+// Renames an identifier of a renamed variable. Procedure results are given an alias instead,
+// as their name is the one the procedure yields.
+static void Rename(std::vector<TextEdit>& edits, const char* query, const std::vector<const cypher_astnode_t*>& path,
+                   const std::string& name) {
+  auto identifier = path.back();
+  auto range = TextRange(query, identifier);
+  auto parent = path.size() > 1 ? path[path.size() - 2] : NULL;
+  auto clause = path.size() > 2 ? path[path.size() - 3] : NULL;
+  if (parent && clause && cypher_astnode_type(parent) == CYPHER_AST_PROJECTION
+      && cypher_astnode_type(clause) == CYPHER_AST_CALL && !cypher_ast_projection_get_alias(parent))
+    edits.push_back({ range.second, range.second, " AS " + Escape(name) });
+  else
+    edits.push_back({ range.first, range.second, Escape(name) });
+}
+
+bool Rewrite(RewriteResult& result, const char* query, size_t length, const ParseOptions& options,
+             const std::vector<RewriteOperation>& operations) {
+  ParsedQuery parsed(query, length, options);
+  if (!parsed.Parsed())
+    return false;
+
+  result.nErrors = parsed.Errors();
+  result.query.assign(query, length);
+  if (result.nErrors)
+    return true;
+
+  ScopeResolver resolver;
+  std::vector<const cypher_astnode_t*> path;
+  std::vector<TextEdit> edits;
+  // Binding of the variable each rename operation applies to in the current statement.
+  std::vector<int> renamed(operations.size(), -1);
+  // RETURN projection without an alias being walked, given one if a variable in it is renamed,
+  // so the column keeps its name.
+  const cypher_astnode_t* column = NULL;
+  bool columnRenamed = false;
+  parsed.ForEachNode([&](const cypher_astnode_t* node) {
+    path.push_back(node);
+    resolver.Enter(node);
+    auto type = cypher_astnode_type(node);
+    auto parent = path.size() > 1 ? path[path.size() - 2] : NULL;
+    if (type == CYPHER_AST_STATEMENT)
+      std::fill(renamed.begin(), renamed.end(), -1);
+    if (type == CYPHER_AST_PROJECTION && parent && cypher_astnode_type(parent) == CYPHER_AST_RETURN
+        && !cypher_ast_projection_get_alias(node)) {
+      column = node;
+      columnRenamed = false;
+    }
+
+    for (size_t i = 0; i < operations.size(); i++) {
+      auto& operation = operations[i];
+      if (operation.type == RewriteOperation::Type::AddPredicate && type == CYPHER_AST_MATCH) {
+        if (Selected(operation, path))
+          AddPredicate(edits, query, node, operation.text);
+      }
+      else if (operation.type == RewriteOperation::Type::AddLabel && type == CYPHER_AST_NODE_PATTERN) {
+        // Labels of nodes with a variable are only added once it is resolved.
+        if (!cypher_ast_node_pattern_get_identifier(node) && Selected(operation, path))
+          AddLabel(edits, query, node, operation.text);
+      }
+      else if (operation.type == RewriteOperation::Type::AddLabel && type == CYPHER_AST_IDENTIFIER && parent
+               && cypher_astnode_type(parent) == CYPHER_AST_NODE_PATTERN
+               && node == cypher_ast_node_pattern_get_identifier(parent)) {
+        // Nodes bound before, as in MATCH (n) CREATE (n)-[:R]->(m), cannot be given labels.
+        auto declared = Declares(resolver, resolver.Current(), node);
+        path.pop_back();
+        if (declared && Selected(operation, path))
+          AddLabel(edits, query, parent, operation.text);
+        path.push_back(node);
+      }
+      else if (operation.type == RewriteOperation::Type::Rename && type == CYPHER_AST_IDENTIFIER
+               && operation.name == cypher_ast_identifier_get_name(node)) {
+        // Only the variable first bound in the statement, or by an identifier selected, is
+        // renamed, not variables of other scopes with the same name.
+        auto binding = resolver.Current();
+        if (renamed[i] == -1 && Declares(resolver, binding, node) && Selected(operation, path))
+          renamed[i] = binding;
+        if (binding == -1 || binding != renamed[i])
+          continue;
+        Rename(edits, query, path, operation.text);
+        columnRenamed = columnRenamed || column;
+      }
+    }
+  }, [&](const cypher_astnode_t* node) {
+    if (node == column) {
+      if (columnRenamed) {
+        auto range = TextRange(query, cypher_ast_projection_get_expression(node));
+        std::string text(query + range.first, range.second - range.first);
+        edits.push_back({ range.second, range.second, " AS " + Escape(text) });
+      }
+      column = NULL;
+    }
+    resolver.Leave(node);
+    path.pop_back();
+  });
+
+  // Edits at the same offset keep the order they were made in.
+  std::stable_sort(edits.begin(), edits.end(), [](const TextEdit& a, const TextEdit& b) { return a.start < b.start; });
+  std::string rewritten;
+  rewritten.reserve(length + edits.size() * 16);
+  size_t copied = 0;
+  for (auto& edit : edits) {
+    if (edit.start < copied)
+      continue;
+    rewritten.append(query + copied, edit.start - copied);
+    rewritten += edit.text;
+    copied = edit.end;
+    result.edits++;
+  }
+  rewritten.append(query + copied, length - copied);
+  result.query = std::move(rewritten);
+  return true;
+}
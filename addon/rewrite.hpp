@@ -0,0 +1,42 @@
+#ifndef __REWRITE_HPP__
+#define __REWRITE_HPP__
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "parser.hpp"
+#include "selector.hpp"
+
+// Change made to every node it applies to, or only to the nodes a selector matches.
+struct RewriteOperation {
+  enum class Type {
+    // Adds a predicate to MATCH clauses, anded with their WHERE if they have one.
+    AddPredicate,
+    // Adds a label to node patterns binding a new variable or none.
+    AddLabel,
+    // Renames a variable: the first one bound in each statement with the name, or the first
+    // whose binding identifier the selector matches. Unaliased RETURN columns keep their names.
+    Rename
+  };
+
+  Type type;
+  // Predicate, label or new name.
+  std::string text;
+  // Identifier renamed.
+  std::string name;
+  std::shared_ptr<const Selector> selector;
+};
+
+struct RewriteResult {
+  std::string query;
+  unsigned int edits = 0;
+  unsigned int nErrors = 0;
+};
+
+// Rewrites the query text itself at the ranges of the AST nodes changed, so the rest of it
+// keeps its formatting and comments. Queries with syntax errors are left as they are.
+bool Rewrite(RewriteResult& result, const char* query, size_t length, const ParseOptions& options,
+             const std::vector<RewriteOperation>& operations);
+
+#endif //__REWRITE_HPP__
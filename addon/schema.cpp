@@ -0,0 +1,102 @@
+#include "schema.hpp"
+#include <algorithm>
+#include <cstring>
+
+static uint64_t Hash(const char* key, size_t length, uint32_t seed) {
+  uint64_t hash = 14695981039346656037ull ^ seed;
+  for (size_t i = 0; i < length; i++)
+    hash = (hash ^ (unsigned char)key[i]) * 1099511628211ull;
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+void PerfectHashSet::Build(std::vector<std::string> keys) {
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  this->keys.swap(keys);
+  seeds.clear();
+  slots.clear();
+  if (this->keys.empty())
+    return;
+
+  // A quarter more slots than keys keeps the search for seeds short. Should a bucket find
+  // no seed, which takes a poor hash, the table doubles and placing starts over.
+  for (size_t nSlots = this->keys.size() + this->keys.size() / 4 + 1; !Place(nSlots); nSlots *= 2);
+}
+
+bool PerfectHashSet::Place(size_t nSlots) {
+  static const uint32_t maxSeed = 1 << 16;
+  size_t nBuckets = keys.size() / 4 + 1;
+  std::vector<std::vector<int>> buckets(nBuckets);
+  for (size_t i = 0; i < keys.size(); i++)
+    buckets[Hash(keys[i].c_str(), keys[i].length(), 0) % nBuckets].push_back((int)i);
+
+  // Largest buckets first, while most slots are free.
+  std::vector<size_t> order(nBuckets);
+  for (size_t i = 0; i < nBuckets; i++)
+    order[i] = i;
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+  seeds.assign(nBuckets, 0);
+  slots.assign(nSlots, -1);
+  std::vector<size_t> placed;
+  for (auto bucket : order) {
+    if (buckets[bucket].empty())
+      break;
+
+    uint32_t seed = 1;
+    for (; seed < maxSeed; seed++) {
+      placed.clear();
+      for (auto key : buckets[bucket]) {
+        auto slot = Hash(keys[key].c_str(), keys[key].length(), seed) % nSlots;
+        if (slots[slot] != -1 || std::find(placed.begin(), placed.end(), slot) != placed.end())
+          break;
+        placed.push_back(slot);
+      }
+      if (placed.size() == buckets[bucket].size())
+        break;
+    }
+    if (seed == maxSeed)
+      return false;
+
+    seeds[bucket] = seed;
+    for (size_t i = 0; i < placed.size(); i++)
+      slots[placed[i]] = buckets[bucket][i];
+  }
+  return true;
+}
+
+int PerfectHashSet::Find(const char* key, size_t length) const {
+  if (slots.empty())
+    return -1;
+
+  auto seed = seeds[Hash(key, length, 0) % seeds.size()];
+  auto id = slots[Hash(key, length, seed) % slots.size()];
+  if (id == -1 || keys[id].length() != length || memcmp(keys[id].data(), key, length))
+    return -1;
+  return id;
+}
+
+static void BuildSets(const GraphSchema::Definition& definition, PerfectHashSet& names, std::vector<PerfectHashSet>& properties,
+                      std::vector<std::string>& allProperties) {
+  std::vector<std::string> keys;
+  for (auto& entry : definition)
+    keys.push_back(entry.first);
+  names.Build(keys);
+
+  properties.resize(names.Size());
+  for (auto& entry : definition) {
+    auto id = names.Find(entry.first.c_str(), entry.first.length());
+    properties[id].Build(entry.second);
+    allProperties.insert(allProperties.end(), entry.second.begin(), entry.second.end());
+  }
+}
+
+GraphSchema::GraphSchema(const Definition& labels, const Definition& relTypes) {
+  std::vector<std::string> allProperties;
+  BuildSets(labels, this->labels, labelProperties, allProperties);
+  BuildSets(relTypes, this->relTypes, relTypeProperties, allProperties);
+  properties.Build(allProperties);
+}
@@ -0,0 +1,53 @@
+#ifndef __SCHEMA_HPP__
+#define __SCHEMA_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Set of strings fixed once built, found through a perfect hash: the bucket of a key picks
+// the seed of its second hash, chosen when building so that no two keys share a slot.
+// Lookups hash the key twice and compare it with one stored key at most.
+class PerfectHashSet {
+public:
+  void Build(std::vector<std::string> keys);
+  // Index of a key in the sorted keys, -1 when absent.
+  int Find(const char* key, size_t length) const;
+  size_t Size() const { return keys.size(); }
+
+private:
+  bool Place(size_t nSlots);
+
+  std::vector<std::string> keys;
+  std::vector<uint32_t> seeds;
+  // Indices into keys, -1 for empty slots.
+  std::vector<int> slots;
+};
+
+// Labels and relationship types of a graph with the property keys of each, compiled once
+// and then shared read only by parses on any thread.
+class GraphSchema {
+public:
+  typedef std::vector<std::pair<std::string, std::vector<std::string>>> Definition;
+
+  GraphSchema(const Definition& labels, const Definition& relTypes);
+
+  const PerfectHashSet& Labels() const { return labels; }
+  const PerfectHashSet& RelTypes() const { return relTypes; }
+  // Property keys of any label or relationship type.
+  const PerfectHashSet& Properties() const { return properties; }
+  // Property keys by index in Labels or RelTypes.
+  const PerfectHashSet& LabelProperties(int label) const { return labelProperties[label]; }
+  const PerfectHashSet& RelTypeProperties(int relType) const { return relTypeProperties[relType]; }
+
+private:
+  PerfectHashSet labels;
+  PerfectHashSet relTypes;
+  PerfectHashSet properties;
+  std::vector<PerfectHashSet> labelProperties;
+  std::vector<PerfectHashSet> relTypeProperties;
+};
+
+#endif //__SCHEMA_HPP__
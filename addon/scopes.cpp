@@ -0,0 +1,204 @@
+#include "scopes.hpp"
+
+static bool IsNestedScope(const cypher_astnode_t* node) {
+  auto type = cypher_astnode_type(node);
+  return type == CYPHER_AST_FOREACH
+    || type == CYPHER_AST_REDUCE
+    || type == CYPHER_AST_PATTERN_COMPREHENSION
+    || cypher_astnode_instanceof(node, CYPHER_AST_LIST_COMPREHENSION);
+}
+
+// Identifier children which bind a variable of their parent, besides patterns and projections.
+static const char* DeclarationKind(const cypher_astnode_t* parent, const cypher_astnode_t* identifier) {
+  auto type = cypher_astnode_type(parent);
+  if (type == CYPHER_AST_UNWIND && identifier == cypher_ast_unwind_get_alias(parent))
+    return "unwind";
+  if (type == CYPHER_AST_LOAD_CSV && identifier == cypher_ast_load_csv_get_identifier(parent))
+    return "load-csv";
+  if (type == CYPHER_AST_FOREACH && identifier == cypher_ast_foreach_get_identifier(parent))
+    return "for-each";
+  if (type == CYPHER_AST_REDUCE && (identifier == cypher_ast_reduce_get_accumulator(parent)
+      || identifier == cypher_ast_reduce_get_identifier(parent)))
+    return "reduce";
+  if (type == CYPHER_AST_PATTERN_COMPREHENSION && identifier == cypher_ast_pattern_comprehension_get_identifier(parent))
+    return "pattern-comprehension";
+  if (cypher_astnode_instanceof(parent, CYPHER_AST_LIST_COMPREHENSION)
+      && identifier == cypher_ast_list_comprehension_get_identifier(parent))
+    return "list-comprehension";
+  if (type == CYPHER_AST_NAMED_PATH && identifier == cypher_ast_named_path_get_identifier(parent))
+    return "named-path";
+
+  if ((type == CYPHER_AST_NODE_INDEX_LOOKUP && identifier == cypher_ast_node_index_lookup_get_identifier(parent))
+      || (type == CYPHER_AST_NODE_INDEX_QUERY && identifier == cypher_ast_node_index_query_get_identifier(parent))
+      || (type == CYPHER_AST_NODE_ID_LOOKUP && identifier == cypher_ast_node_id_lookup_get_identifier(parent))
+      || (type == CYPHER_AST_ALL_NODES_SCAN && identifier == cypher_ast_all_nodes_scan_get_identifier(parent))
+      || (type == CYPHER_AST_REL_INDEX_LOOKUP && identifier == cypher_ast_rel_index_lookup_get_identifier(parent))
+      || (type == CYPHER_AST_REL_INDEX_QUERY && identifier == cypher_ast_rel_index_query_get_identifier(parent))
+      || (type == CYPHER_AST_REL_ID_LOOKUP && identifier == cypher_ast_rel_id_lookup_get_identifier(parent))
+      || (type == CYPHER_AST_ALL_RELS_SCAN && identifier == cypher_ast_all_rels_scan_get_identifier(parent)))
+    return "start";
+
+  if ((type == CYPHER_AST_CREATE_NODE_PROP_CONSTRAINT && identifier == cypher_ast_create_node_prop_constraint_get_identifier(parent))
+      || (type == CYPHER_AST_DROP_NODE_PROP_CONSTRAINT && identifier == cypher_ast_drop_node_prop_constraint_get_identifier(parent))
+      || (type == CYPHER_AST_CREATE_REL_PROP_CONSTRAINT && identifier == cypher_ast_create_rel_prop_constraint_get_identifier(parent))
+      || (type == CYPHER_AST_DROP_REL_PROP_CONSTRAINT && identifier == cypher_ast_drop_rel_prop_constraint_get_identifier(parent)))
+    return "constraint";
+  return NULL;
+}
+
+ScopeResolver::Scope& ScopeResolver::QueryScope() {
+  for (auto scope = scopes.rbegin(); scope != scopes.rend(); scope++) {
+    if (scope->boundary)
+      return *scope;
+  }
+  return scopes.front();
+}
+
+// Aliases are only looked up outside of projections, so the expression of an alias still
+// sees the variable it may replace.
+int ScopeResolver::Lookup(const std::string& name) const {
+  for (auto scope = scopes.rbegin(); scope != scopes.rend(); scope++) {
+    if (!projections) {
+      auto found = scope->projected.find(name);
+      if (found != scope->projected.end())
+        return found->second;
+    }
+    auto found = scope->names.find(name);
+    if (found != scope->names.end())
+      return found->second;
+    if (scope->boundary)
+      break;
+  }
+  return -1;
+}
+
+int ScopeResolver::Declare(const std::string& name, const char* kind, const cypher_astnode_t* identifier,
+                           std::unordered_map<std::string, int>& names, bool shadowing) {
+  if (shadowing && Lookup(name) != -1)
+    problem = Shadowed;
+
+  int id = (int)bindings.size();
+  bindings.push_back({ name, kind, cypher_astnode_range(identifier).start });
+  names[name] = id;
+  return id;
+}
+
+// Variables of patterns belong to the clause of the pattern.
+const char* ScopeResolver::PatternKind() const {
+  for (auto parent = parents.rbegin(); parent != parents.rend(); parent++) {
+    auto type = cypher_astnode_type(*parent);
+    if (type == CYPHER_AST_MATCH)
+      return "match";
+    if (type == CYPHER_AST_MERGE)
+      return "merge";
+    if (type == CYPHER_AST_CREATE)
+      return "create";
+    if (type == CYPHER_AST_PATTERN_COMPREHENSION)
+      return "pattern-comprehension";
+  }
+  return "pattern";
+}
+
+void ScopeResolver::Resolve(const cypher_astnode_t* identifier) {
+  std::string name = cypher_ast_identifier_get_name(identifier);
+  current = -1;
+  problem = None;
+  if (scopes.empty() || parents.empty()) {
+    problem = Unbound;
+    return;
+  }
+
+  auto parent = parents.back();
+  auto type = cypher_astnode_type(parent);
+  if ((type == CYPHER_AST_NODE_PATTERN && identifier == cypher_ast_node_pattern_get_identifier(parent))
+      || (type == CYPHER_AST_REL_PATTERN && identifier == cypher_ast_rel_pattern_get_identifier(parent))) {
+    // Pattern variables bound before are the same nodes or relationships.
+    current = Lookup(name);
+    if (current == -1)
+      current = Declare(name, PatternKind(), identifier, scopes.back().names, false);
+    return;
+  }
+
+  if (type == CYPHER_AST_PROJECTION) {
+    auto clause = parents.size() < 2 ? CYPHER_AST_WITH : cypher_astnode_type(parents[parents.size() - 2]);
+    auto alias = cypher_ast_projection_get_alias(parent);
+    auto expression = cypher_ast_projection_get_expression(parent);
+    if (clause == CYPHER_AST_CALL) {
+      // Procedure results are bound by their alias, or by their own name without one.
+      if (identifier == (alias ? alias : expression))
+        current = Declare(name, "call", identifier, QueryScope().names, true);
+      return;
+    }
+    if (identifier == alias) {
+      current = Declare(name, clause == CYPHER_AST_RETURN ? "return" : "with", identifier, QueryScope().projected, false);
+      return;
+    }
+    // Variables projected as they are keep their binding.
+    if (!alias && identifier == expression) {
+      current = Lookup(name);
+      if (current == -1)
+        problem = Unbound;
+      else
+        QueryScope().projected[name] = current;
+      return;
+    }
+  }
+
+  auto kind = DeclarationKind(parent, identifier);
+  if (kind) {
+    current = Declare(name, kind, identifier, scopes.back().names, true);
+    return;
+  }
+
+  current = Lookup(name);
+  if (current == -1)
+    problem = Unbound;
+}
+
+int ScopeResolver::Binding(const cypher_astnode_t* identifier) const {
+  auto found = resolved.find(identifier);
+  return found == resolved.end() ? -1 : found->second;
+}
+
+void ScopeResolver::Enter(const cypher_astnode_t* node) {
+  auto type = cypher_astnode_type(node);
+  if (type == CYPHER_AST_STATEMENT || type == CYPHER_AST_QUERY)
+    scopes.push_back({ {}, {}, true });
+  else if (IsNestedScope(node))
+    scopes.push_back({ {}, {}, false });
+  else if (type == CYPHER_AST_IDENTIFIER) {
+    Resolve(node);
+    if (current != -1)
+      resolved[node] = current;
+  }
+
+  parents.push_back(node);
+  if (type == CYPHER_AST_PROJECTION)
+    projections++;
+}
+
+void ScopeResolver::Leave(const cypher_astnode_t* node) {
+  parents.pop_back();
+  if (scopes.empty())
+    return;
+
+  auto type = cypher_astnode_type(node);
+  if (type == CYPHER_AST_PROJECTION)
+    projections--;
+  else if (type == CYPHER_AST_STATEMENT || type == CYPHER_AST_QUERY || IsNestedScope(node))
+    scopes.pop_back();
+  else if (type == CYPHER_AST_WITH) {
+    auto& scope = QueryScope();
+    if (!cypher_ast_with_has_include_existing(node))
+      scope.names.clear();
+    for (auto& alias : scope.projected)
+      scope.names[alias.first] = alias.second;
+    scope.projected.clear();
+  }
+  else if (type == CYPHER_AST_RETURN)
+    QueryScope().projected.clear();
+  else if (type == CYPHER_AST_UNION) {
+    QueryScope().names.clear();
+    QueryScope().projected.clear();
+  }
+}
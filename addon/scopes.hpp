@@ -0,0 +1,60 @@
+#ifndef __SCOPES_HPP__
+#define __SCOPES_HPP__
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cypher-parser.h>
+
+// A variable bound by the query. Its id is the offset of the identifier binding it.
+struct VariableBinding {
+  std::string name;
+  // Type name of the clause or expression binding it, as "match", "unwind" or "reduce".
+  const char* kind;
+  struct cypher_input_position position;
+};
+
+// Resolves every identifier to the variable it names as NodeBin walks the AST. Query parts
+// end at WITH and UNION, comprehensions, FOREACH and REDUCE open scopes nested in them.
+class ScopeResolver {
+public:
+  enum Problem { None, Unbound, Shadowed };
+
+  void Enter(const cypher_astnode_t* node);
+  void Leave(const cypher_astnode_t* node);
+
+  // Binding of the identifier last entered, -1 when it is unbound.
+  int Current() const { return current; }
+  // Problem found with the identifier last entered.
+  Problem CurrentProblem() const { return problem; }
+  // Binding of an identifier entered before, -1 when it is unbound.
+  int Binding(const cypher_astnode_t* identifier) const;
+  const std::vector<VariableBinding>& Bindings() const { return bindings; }
+
+private:
+  struct Scope {
+    std::unordered_map<std::string, int> names;
+    // Aliases of the projections of the current WITH or RETURN, visible to its ORDER BY
+    // and WHERE, and to the next query part after a WITH.
+    std::unordered_map<std::string, int> projected;
+    // Query parts and statements end the search for a name, nested scopes do not.
+    bool boundary;
+  };
+
+  void Resolve(const cypher_astnode_t* identifier);
+  int Lookup(const std::string& name) const;
+  int Declare(const std::string& name, const char* kind, const cypher_astnode_t* identifier,
+              std::unordered_map<std::string, int>& names, bool shadowing);
+  const char* PatternKind() const;
+  Scope& QueryScope();
+
+  std::vector<Scope> scopes;
+  std::vector<const cypher_astnode_t*> parents;
+  std::vector<VariableBinding> bindings;
+  std::unordered_map<const cypher_astnode_t*, int> resolved;
+  unsigned int projections = 0;
+  int current = -1;
+  Problem problem = None;
+};
+
+#endif //__SCOPES_HPP__
@@ -0,0 +1,588 @@
+#include "selector.hpp"
+#include <cstring>
+
+enum class AccessorKind {
+  Text,
+  Flag,
+  Number,
+  Op,
+  Child,
+  List,
+  Ops,
+  Pairs
+};
+
+// Reads one member of the nodes of a type, as the walk writes it.
+struct AttributeAccessor {
+  AccessorKind kind;
+  const cypher_astnode_type_t* type;
+  const char* name;
+  const char* (*text)(const cypher_astnode_t*);
+  bool (*flag)(const cypher_astnode_t*);
+  unsigned int (*number)(const cypher_astnode_t*);
+  const cypher_operator_t* (*op)(const cypher_astnode_t*);
+  const cypher_astnode_t* (*child)(const cypher_astnode_t*);
+  unsigned int (*count)(const cypher_astnode_t*);
+  const cypher_astnode_t* (*element)(const cypher_astnode_t*, unsigned int);
+  const cypher_operator_t* (*opElement)(const cypher_astnode_t*, unsigned int);
+  // Values of pairs, whose keys are the elements.
+  const cypher_astnode_t* (*value)(const cypher_astnode_t*, unsigned int);
+};
+
+static AttributeAccessor Accessor(AccessorKind kind, const cypher_astnode_type_t* type, const char* name) {
+  AttributeAccessor accessor = {};
+  accessor.kind = kind;
+  accessor.type = type;
+  accessor.name = name;
+  return accessor;
+}
+
+static AttributeAccessor Text(const cypher_astnode_type_t* type, const char* name,
+                              const char* (*text)(const cypher_astnode_t*)) {
+  auto accessor = Accessor(AccessorKind::Text, type, name);
+  accessor.text = text;
+  return accessor;
+}
+
+static AttributeAccessor Flag(const cypher_astnode_type_t* type, const char* name,
+                              bool (*flag)(const cypher_astnode_t*)) {
+  auto accessor = Accessor(AccessorKind::Flag, type, name);
+  accessor.flag = flag;
+  return accessor;
+}
+
+static AttributeAccessor Number(const cypher_astnode_type_t* type, const char* name,
+                                unsigned int (*number)(const cypher_astnode_t*)) {
+  auto accessor = Accessor(AccessorKind::Number, type, name);
+  accessor.number = number;
+  return accessor;
+}
+
+static AttributeAccessor Op(const cypher_astnode_type_t* type, const char* name,
+                            const cypher_operator_t* (*op)(const cypher_astnode_t*)) {
+  auto accessor = Accessor(AccessorKind::Op, type, name);
+  accessor.op = op;
+  return accessor;
+}
+
+static AttributeAccessor Child(const cypher_astnode_type_t* type, const char* name,
+                               const cypher_astnode_t* (*child)(const cypher_astnode_t*)) {
+  auto accessor = Accessor(AccessorKind::Child, type, name);
+  accessor.child = child;
+  return accessor;
+}
+
+static AttributeAccessor List(const cypher_astnode_type_t* type, const char* name,
+                              unsigned int (*count)(const cypher_astnode_t*),
+                              const cypher_astnode_t* (*element)(const cypher_astnode_t*, unsigned int)) {
+  auto accessor = Accessor(AccessorKind::List, type, name);
+  accessor.count = count;
+  accessor.element = element;
+  return accessor;
+}
+
+static AttributeAccessor Ops(const cypher_astnode_type_t* type, const char* name,
+                             unsigned int (*count)(const cypher_astnode_t*),
+                             const cypher_operator_t* (*opElement)(const cypher_astnode_t*, unsigned int)) {
+  auto accessor = Accessor(AccessorKind::Ops, type, name);
+  accessor.count = count;
+  accessor.opElement = opElement;
+  return accessor;
+}
+
+static AttributeAccessor Pairs(const cypher_astnode_type_t* type, const char* name,
+                               unsigned int (*count)(const cypher_astnode_t*),
+                               const cypher_astnode_t* (*key)(const cypher_astnode_t*, unsigned int),
+                               const cypher_astnode_t* (*value)(const cypher_astnode_t*, unsigned int)) {
+  auto accessor = Accessor(AccessorKind::Pairs, type, name);
+  accessor.count = count;
+  accessor.element = key;
+  accessor.value = value;
+  return accessor;
+}
+
+static unsigned int RelDirection(const cypher_astnode_t* node) {
+  return (unsigned int)cypher_ast_rel_pattern_get_direction(node);
+}
+
+static unsigned int ComparisonArguments(const cypher_astnode_t* node) {
+  return cypher_ast_comparison_get_length(node) + 1;
+}
+
+// Members of every node type, named as in parse results. Text members are the names and
+// values of name, literal and identifier nodes, and stand for those nodes as members of others.
+// Entries of maps and alternatives of case expressions are pairs, matched by their key or value.
+// The binding of identifiers, only written with the scopes option, is not a member.
+static const std::vector<AttributeAccessor> accessors = {
+  Text(&CYPHER_AST_PARAMETER, "name", cypher_ast_parameter_get_name),
+  Text(&CYPHER_AST_IDENTIFIER, "name", cypher_ast_identifier_get_name),
+  Text(&CYPHER_AST_STRING, "value", cypher_ast_string_get_value),
+  Text(&CYPHER_AST_LABEL, "name", cypher_ast_label_get_name),
+  Text(&CYPHER_AST_RELTYPE, "name", cypher_ast_reltype_get_name),
+  Text(&CYPHER_AST_PROP_NAME, "value", cypher_ast_prop_name_get_value),
+  Text(&CYPHER_AST_FUNCTION_NAME, "value", cypher_ast_function_name_get_value),
+  Text(&CYPHER_AST_INDEX_NAME, "value", cypher_ast_index_name_get_value),
+  Text(&CYPHER_AST_PROC_NAME, "value", cypher_ast_proc_name_get_value),
+  Text(&CYPHER_AST_COMMAND, "name", cypher_ast_command_get_name),
+  Text(&CYPHER_AST_LINE_COMMENT, "value", cypher_ast_line_comment_get_value),
+  Text(&CYPHER_AST_BLOCK_COMMENT, "value", cypher_ast_block_comment_get_value),
+  Text(&CYPHER_AST_ERROR, "value", cypher_ast_error_get_value),
+  Text(&CYPHER_AST_INTEGER, "value", cypher_ast_integer_get_valuestr),
+  Text(&CYPHER_AST_FLOAT, "value", cypher_ast_float_get_valuestr),
+  Flag(&CYPHER_AST_MATCH, "optional", cypher_ast_match_is_optional),
+  Flag(&CYPHER_AST_CREATE_NODE_PROP_CONSTRAINT, "unique", cypher_ast_create_node_prop_constraint_is_unique),
+  Flag(&CYPHER_AST_DROP_NODE_PROP_CONSTRAINT, "unique", cypher_ast_drop_node_prop_constraint_is_unique),
+  Flag(&CYPHER_AST_CREATE_REL_PROP_CONSTRAINT, "unique", cypher_ast_create_rel_prop_constraint_is_unique),
+  Flag(&CYPHER_AST_DROP_REL_PROP_CONSTRAINT, "unique", cypher_ast_drop_rel_prop_constraint_is_unique),
+  Flag(&CYPHER_AST_LOAD_CSV, "withHeaders", cypher_ast_load_csv_has_with_headers),
+  Flag(&CYPHER_AST_CREATE, "unique", cypher_ast_create_is_unique),
+  Flag(&CYPHER_AST_DELETE, "detach", cypher_ast_delete_has_detach),
+  Flag(&CYPHER_AST_WITH, "distinct", cypher_ast_with_is_distinct),
+  Flag(&CYPHER_AST_WITH, "includeExisting", cypher_ast_with_has_include_existing),
+  Flag(&CYPHER_AST_RETURN, "distinct", cypher_ast_return_is_distinct),
+  Flag(&CYPHER_AST_RETURN, "includeExisting", cypher_ast_return_has_include_existing),
+  Flag(&CYPHER_AST_SORT_ITEM, "ascending", cypher_ast_sort_item_is_ascending),
+  Flag(&CYPHER_AST_UNION, "all", cypher_ast_union_has_all),
+  Flag(&CYPHER_AST_APPLY_OPERATOR, "distinct", cypher_ast_apply_operator_get_distinct),
+  Flag(&CYPHER_AST_APPLY_ALL_OPERATOR, "distinct", cypher_ast_apply_all_operator_get_distinct),
+  Flag(&CYPHER_AST_SHORTEST_PATH, "single", cypher_ast_shortest_path_is_single),
+  Number(&CYPHER_AST_COMPARISON, "length", cypher_ast_comparison_get_length),
+  Number(&CYPHER_AST_REL_PATTERN, "direction", RelDirection),
+  Op(&CYPHER_AST_UNARY_OPERATOR, "op", cypher_ast_unary_operator_get_operator),
+  Op(&CYPHER_AST_BINARY_OPERATOR, "op", cypher_ast_binary_operator_get_operator),
+  Child(&CYPHER_AST_CYPHER_OPTION, "version", cypher_ast_cypher_option_get_version),
+  Child(&CYPHER_AST_MATCH, "pattern", cypher_ast_match_get_pattern),
+  Child(&CYPHER_AST_MATCH, "predicate", cypher_ast_match_get_predicate),
+  Child(&CYPHER_AST_STATEMENT, "body", cypher_ast_statement_get_body),
+  Child(&CYPHER_AST_CYPHER_OPTION_PARAM, "name", cypher_ast_cypher_option_param_get_name),
+  Child(&CYPHER_AST_CYPHER_OPTION_PARAM, "value", cypher_ast_cypher_option_param_get_value),
+  Child(&CYPHER_AST_CREATE_NODE_PROP_INDEX, "label", cypher_ast_create_node_prop_index_get_label),
+  Child(&CYPHER_AST_CREATE_NODE_PROP_INDEX, "propName", cypher_ast_create_node_prop_index_get_prop_name),
+  Child(&CYPHER_AST_DROP_NODE_PROP_INDEX, "label", cypher_ast_drop_node_prop_index_get_label),
+  Child(&CYPHER_AST_DROP_NODE_PROP_INDEX, "propName", cypher_ast_drop_node_prop_index_get_prop_name),
+  Child(&CYPHER_AST_CREATE_NODE_PROP_CONSTRAINT, "identifier", cypher_ast_create_node_prop_constraint_get_identifier),
+  Child(&CYPHER_AST_CREATE_NODE_PROP_CONSTRAINT, "label", cypher_ast_create_node_prop_constraint_get_label),
+  Child(&CYPHER_AST_CREATE_NODE_PROP_CONSTRAINT, "expression", cypher_ast_create_node_prop_constraint_get_expression),
+  Child(&CYPHER_AST_DROP_NODE_PROP_CONSTRAINT, "identifier", cypher_ast_drop_node_prop_constraint_get_identifier),
+  Child(&CYPHER_AST_DROP_NODE_PROP_CONSTRAINT, "label", cypher_ast_drop_node_prop_constraint_get_label),
+  Child(&CYPHER_AST_DROP_NODE_PROP_CONSTRAINT, "expression", cypher_ast_drop_node_prop_constraint_get_expression),
+  Child(&CYPHER_AST_CREATE_REL_PROP_CONSTRAINT, "identifier", cypher_ast_create_rel_prop_constraint_get_identifier),
+  Child(&CYPHER_AST_CREATE_REL_PROP_CONSTRAINT, "relType", cypher_ast_create_rel_prop_constraint_get_reltype),
+  Child(&CYPHER_AST_CREATE_REL_PROP_CONSTRAINT, "expression", cypher_ast_create_rel_prop_constraint_get_expression),
+  Child(&CYPHER_AST_DROP_REL_PROP_CONSTRAINT, "identifier", cypher_ast_drop_rel_prop_constraint_get_identifier),
+  Child(&CYPHER_AST_DROP_REL_PROP_CONSTRAINT, "relType", cypher_ast_drop_rel_prop_constraint_get_reltype),
+  Child(&CYPHER_AST_DROP_REL_PROP_CONSTRAINT, "expression", cypher_ast_drop_rel_prop_constraint_get_expression),
+  Child(&CYPHER_AST_USING_PERIODIC_COMMIT, "limit", cypher_ast_using_periodic_commit_get_limit),
+  Child(&CYPHER_AST_LOAD_CSV, "url", cypher_ast_load_csv_get_url),
+  Child(&CYPHER_AST_LOAD_CSV, "identifier", cypher_ast_load_csv_get_identifier),
+  Child(&CYPHER_AST_LOAD_CSV, "fieldTerminator", cypher_ast_load_csv_get_field_terminator),
+  Child(&CYPHER_AST_START, "predicate", cypher_ast_start_get_predicate),
+  Child(&CYPHER_AST_NODE_INDEX_LOOKUP, "identifier", cypher_ast_node_index_lookup_get_identifier),
+  Child(&CYPHER_AST_NODE_INDEX_LOOKUP, "indexName", cypher_ast_node_index_lookup_get_index_name),
+  Child(&CYPHER_AST_NODE_INDEX_LOOKUP, "propName", cypher_ast_node_index_lookup_get_prop_name),
+  Child(&CYPHER_AST_NODE_INDEX_LOOKUP, "lookup", cypher_ast_node_index_lookup_get_lookup),
+  Child(&CYPHER_AST_NODE_INDEX_QUERY, "identifier", cypher_ast_node_index_query_get_identifier),
+  Child(&CYPHER_AST_NODE_INDEX_QUERY, "indexName", cypher_ast_node_index_query_get_index_name),
+  Child(&CYPHER_AST_NODE_INDEX_QUERY, "query", cypher_ast_node_index_query_get_query),
+  Child(&CYPHER_AST_NODE_ID_LOOKUP, "identifier", cypher_ast_node_id_lookup_get_identifier),
+  Child(&CYPHER_AST_ALL_NODES_SCAN, "identifier", cypher_ast_all_nodes_scan_get_identifier),
+  Child(&CYPHER_AST_REL_INDEX_LOOKUP, "identifier", cypher_ast_rel_index_lookup_get_identifier),
+  Child(&CYPHER_AST_REL_INDEX_LOOKUP, "indexName", cypher_ast_rel_index_lookup_get_index_name),
+  Child(&CYPHER_AST_REL_INDEX_LOOKUP, "propName", cypher_ast_rel_index_lookup_get_prop_name),
+  Child(&CYPHER_AST_REL_INDEX_LOOKUP, "lookup", cypher_ast_rel_index_lookup_get_lookup),
+  Child(&CYPHER_AST_REL_INDEX_QUERY, "identifier", cypher_ast_rel_index_query_get_identifier),
+  Child(&CYPHER_AST_REL_INDEX_QUERY, "indexName", cypher_ast_rel_index_query_get_index_name),
+  Child(&CYPHER_AST_REL_INDEX_QUERY, "query", cypher_ast_rel_index_query_get_query),
+  Child(&CYPHER_AST_REL_ID_LOOKUP, "identifier", cypher_ast_rel_id_lookup_get_identifier),
+  Child(&CYPHER_AST_ALL_RELS_SCAN, "identifier", cypher_ast_all_rels_scan_get_identifier),
+  Child(&CYPHER_AST_USING_INDEX, "identifier", cypher_ast_using_index_get_identifier),
+  Child(&CYPHER_AST_USING_INDEX, "label", cypher_ast_using_index_get_label),
+  Child(&CYPHER_AST_USING_INDEX, "propName", cypher_ast_using_index_get_prop_name),
+  Child(&CYPHER_AST_USING_SCAN, "identifier", cypher_ast_using_scan_get_identifier),
+  Child(&CYPHER_AST_USING_SCAN, "label", cypher_ast_using_scan_get_label),
+  Child(&CYPHER_AST_MERGE, "path", cypher_ast_merge_get_pattern_path),
+  Child(&CYPHER_AST_CREATE, "pattern", cypher_ast_create_get_pattern),
+  Child(&CYPHER_AST_SET_PROPERTY, "property", cypher_ast_set_property_get_property),
+  Child(&CYPHER_AST_SET_PROPERTY, "expression", cypher_ast_set_property_get_expression),
+  Child(&CYPHER_AST_SET_ALL_PROPERTIES, "identifier", cypher_ast_set_all_properties_get_identifier),
+  Child(&CYPHER_AST_SET_ALL_PROPERTIES, "expression", cypher_ast_set_all_properties_get_expression),
+  Child(&CYPHER_AST_MERGE_PROPERTIES, "identifier", cypher_ast_merge_properties_get_identifier),
+  Child(&CYPHER_AST_MERGE_PROPERTIES, "expression", cypher_ast_merge_properties_get_expression),
+  Child(&CYPHER_AST_SET_LABELS, "identifier", cypher_ast_set_labels_get_identifier),
+  Child(&CYPHER_AST_REMOVE_LABELS, "identifier", cypher_ast_remove_labels_get_identifier),
+  Child(&CYPHER_AST_REMOVE_PROPERTY, "property", cypher_ast_remove_property_get_property),
+  Child(&CYPHER_AST_FOREACH, "identifier", cypher_ast_foreach_get_identifier),
+  Child(&CYPHER_AST_FOREACH, "expression", cypher_ast_foreach_get_expression),
+  Child(&CYPHER_AST_WITH, "orderBy", cypher_ast_with_get_order_by),
+  Child(&CYPHER_AST_WITH, "skip", cypher_ast_with_get_skip),
+  Child(&CYPHER_AST_WITH, "limit", cypher_ast_with_get_limit),
+  Child(&CYPHER_AST_WITH, "predicate", cypher_ast_with_get_predicate),
+  Child(&CYPHER_AST_UNWIND, "expression", cypher_ast_unwind_get_expression),
+  Child(&CYPHER_AST_UNWIND, "alias", cypher_ast_unwind_get_alias),
+  Child(&CYPHER_AST_CALL, "procName", cypher_ast_call_get_proc_name),
+  Child(&CYPHER_AST_RETURN, "orderBy", cypher_ast_return_get_order_by),
+  Child(&CYPHER_AST_RETURN, "skip", cypher_ast_return_get_skip),
+  Child(&CYPHER_AST_RETURN, "limit", cypher_ast_return_get_limit),
+  Child(&CYPHER_AST_PROJECTION, "expression", cypher_ast_projection_get_expression),
+  Child(&CYPHER_AST_PROJECTION, "alias", cypher_ast_projection_get_alias),
+  Child(&CYPHER_AST_SORT_ITEM, "expression", cypher_ast_sort_item_get_expression),
+  Child(&CYPHER_AST_UNARY_OPERATOR, "arg", cypher_ast_unary_operator_get_argument),
+  Child(&CYPHER_AST_BINARY_OPERATOR, "arg1", cypher_ast_binary_operator_get_argument1),
+  Child(&CYPHER_AST_BINARY_OPERATOR, "arg2", cypher_ast_binary_operator_get_argument2),
+  Child(&CYPHER_AST_APPLY_OPERATOR, "funcName", cypher_ast_apply_operator_get_func_name),
+  Child(&CYPHER_AST_APPLY_ALL_OPERATOR, "funcName", cypher_ast_apply_all_operator_get_func_name),
+  Child(&CYPHER_AST_PROPERTY_OPERATOR, "expression", cypher_ast_property_operator_get_expression),
+  Child(&CYPHER_AST_PROPERTY_OPERATOR, "propName", cypher_ast_property_operator_get_prop_name),
+  Child(&CYPHER_AST_SUBSCRIPT_OPERATOR, "expression", cypher_ast_subscript_operator_get_expression),
+  Child(&CYPHER_AST_SUBSCRIPT_OPERATOR, "subscript", cypher_ast_subscript_operator_get_subscript),
+  Child(&CYPHER_AST_SLICE_OPERATOR, "expression", cypher_ast_slice_operator_get_expression),
+  Child(&CYPHER_AST_SLICE_OPERATOR, "start", cypher_ast_slice_operator_get_start),
+  Child(&CYPHER_AST_SLICE_OPERATOR, "end", cypher_ast_slice_operator_get_end),
+  Child(&CYPHER_AST_MAP_PROJECTION, "expression", cypher_ast_map_projection_get_expression),
+  Child(&CYPHER_AST_MAP_PROJECTION_LITERAL, "propName", cypher_ast_map_projection_literal_get_prop_name),
+  Child(&CYPHER_AST_MAP_PROJECTION_LITERAL, "expression", cypher_ast_map_projection_literal_get_expression),
+  Child(&CYPHER_AST_MAP_PROJECTION_PROPERTY, "propName", cypher_ast_map_projection_property_get_prop_name),
+  Child(&CYPHER_AST_MAP_PROJECTION_IDENTIFIER, "identifier", cypher_ast_map_projection_identifier_get_identifier),
+  Child(&CYPHER_AST_LABELS_OPERATOR, "expression", cypher_ast_labels_operator_get_expression),
+  Child(&CYPHER_AST_LIST_COMPREHENSION, "identifier", cypher_ast_list_comprehension_get_identifier),
+  Child(&CYPHER_AST_LIST_COMPREHENSION, "expression", cypher_ast_list_comprehension_get_expression),
+  Child(&CYPHER_AST_LIST_COMPREHENSION, "predicate", cypher_ast_list_comprehension_get_predicate),
+  Child(&CYPHER_AST_LIST_COMPREHENSION, "eval", cypher_ast_list_comprehension_get_eval),
+  Child(&CYPHER_AST_PATTERN_COMPREHENSION, "identifier", cypher_ast_pattern_comprehension_get_identifier),
+  Child(&CYPHER_AST_PATTERN_COMPREHENSION, "pattern", cypher_ast_pattern_comprehension_get_pattern),
+  Child(&CYPHER_AST_PATTERN_COMPREHENSION, "predicate", cypher_ast_pattern_comprehension_get_predicate),
+  Child(&CYPHER_AST_PATTERN_COMPREHENSION, "eval", cypher_ast_pattern_comprehension_get_eval),
+  Child(&CYPHER_AST_CASE, "expression", cypher_ast_case_get_expression),
+  Child(&CYPHER_AST_CASE, "default", cypher_ast_case_get_default),
+  Child(&CYPHER_AST_FILTER, "identifier", cypher_ast_list_comprehension_get_identifier),
+  Child(&CYPHER_AST_FILTER, "expression", cypher_ast_list_comprehension_get_expression),
+  Child(&CYPHER_AST_FILTER, "predicate", cypher_ast_list_comprehension_get_predicate),
+  Child(&CYPHER_AST_EXTRACT, "identifier", cypher_ast_list_comprehension_get_identifier),
+  Child(&CYPHER_AST_EXTRACT, "expression", cypher_ast_list_comprehension_get_expression),
+  Child(&CYPHER_AST_EXTRACT, "eval", cypher_ast_pattern_comprehension_get_eval),
+  Child(&CYPHER_AST_REDUCE, "accumulator", cypher_ast_reduce_get_accumulator),
+  Child(&CYPHER_AST_REDUCE, "init", cypher_ast_reduce_get_init),
+  Child(&CYPHER_AST_REDUCE, "identifier", cypher_ast_reduce_get_identifier),
+  Child(&CYPHER_AST_REDUCE, "expression", cypher_ast_reduce_get_expression),
+  Child(&CYPHER_AST_REDUCE, "eval", cypher_ast_reduce_get_eval),
+  Child(&CYPHER_AST_ALL, "identifier", cypher_ast_list_comprehension_get_identifier),
+  Child(&CYPHER_AST_ALL, "expression", cypher_ast_list_comprehension_get_expression),
+  Child(&CYPHER_AST_ALL, "predicate", cypher_ast_list_comprehension_get_predicate),
+  Child(&CYPHER_AST_ANY, "identifier", cypher_ast_list_comprehension_get_identifier),
+  Child(&CYPHER_AST_ANY, "expression", cypher_ast_list_comprehension_get_expression),
+  Child(&CYPHER_AST_ANY, "predicate", cypher_ast_list_comprehension_get_predicate),
+  Child(&CYPHER_AST_SINGLE, "identifier", cypher_ast_list_comprehension_get_identifier),
+  Child(&CYPHER_AST_SINGLE, "expression", cypher_ast_list_comprehension_get_expression),
+  Child(&CYPHER_AST_SINGLE, "predicate", cypher_ast_list_comprehension_get_predicate),
+  Child(&CYPHER_AST_NONE, "identifier", cypher_ast_list_comprehension_get_identifier),
+  Child(&CYPHER_AST_NONE, "expression", cypher_ast_list_comprehension_get_expression),
+  Child(&CYPHER_AST_NONE, "predicate", cypher_ast_list_comprehension_get_predicate),
+  Child(&CYPHER_AST_NAMED_PATH, "identifier", cypher_ast_named_path_get_identifier),
+  Child(&CYPHER_AST_NAMED_PATH, "path", cypher_ast_named_path_get_path),
+  Child(&CYPHER_AST_SHORTEST_PATH, "path", cypher_ast_shortest_path_get_path),
+  Child(&CYPHER_AST_NODE_PATTERN, "identifier", cypher_ast_node_pattern_get_identifier),
+  Child(&CYPHER_AST_NODE_PATTERN, "properties", cypher_ast_node_pattern_get_properties),
+  Child(&CYPHER_AST_REL_PATTERN, "identifier", cypher_ast_rel_pattern_get_identifier),
+  Child(&CYPHER_AST_REL_PATTERN, "properties", cypher_ast_rel_pattern_get_properties),
+  Child(&CYPHER_AST_REL_PATTERN, "varLength", cypher_ast_rel_pattern_get_varlength),
+  Child(&CYPHER_AST_RANGE, "start", cypher_ast_range_get_start),
+  Child(&CYPHER_AST_RANGE, "end", cypher_ast_range_get_end),
+  List(&CYPHER_AST_MATCH, "hints", cypher_ast_match_nhints, cypher_ast_match_get_hint),
+  List(&CYPHER_AST_QUERY, "clauses", cypher_ast_query_nclauses, cypher_ast_query_get_clause),
+  List(&CYPHER_AST_QUERY, "options", cypher_ast_query_noptions, cypher_ast_query_get_option),
+  List(&CYPHER_AST_STATEMENT, "options", cypher_ast_statement_noptions, cypher_ast_statement_get_option),
+  List(&CYPHER_AST_CYPHER_OPTION, "params", cypher_ast_cypher_option_nparams, cypher_ast_cypher_option_get_param),
+  List(&CYPHER_AST_START, "points", cypher_ast_start_npoints, cypher_ast_start_get_point),
+  List(&CYPHER_AST_NODE_ID_LOOKUP, "ids", cypher_ast_node_id_lookup_nids, cypher_ast_node_id_lookup_get_id),
+  List(&CYPHER_AST_REL_ID_LOOKUP, "ids", cypher_ast_rel_id_lookup_nids, cypher_ast_rel_id_lookup_get_id),
+  List(&CYPHER_AST_USING_JOIN, "identifiers", cypher_ast_using_join_nidentifiers, cypher_ast_using_join_get_identifier),
+  List(&CYPHER_AST_MERGE, "actions", cypher_ast_merge_nactions, cypher_ast_merge_get_action),
+  List(&CYPHER_AST_ON_MATCH, "items", cypher_ast_on_match_nitems, cypher_ast_on_match_get_item),
+  List(&CYPHER_AST_ON_CREATE, "items", cypher_ast_on_create_nitems, cypher_ast_on_create_get_item),
+  List(&CYPHER_AST_SET, "items", cypher_ast_set_nitems, cypher_ast_set_get_item),
+  List(&CYPHER_AST_SET_LABELS, "labels", cypher_ast_set_labels_nlabels, cypher_ast_set_labels_get_label),
+  List(&CYPHER_AST_DELETE, "expressions", cypher_ast_delete_nexpressions, cypher_ast_delete_get_expression),
+  List(&CYPHER_AST_REMOVE, "items", cypher_ast_remove_nitems, cypher_ast_remove_get_item),
+  List(&CYPHER_AST_REMOVE_LABELS, "labels", cypher_ast_remove_labels_nlabels, cypher_ast_remove_labels_get_label),
+  List(&CYPHER_AST_FOREACH, "clauses", cypher_ast_foreach_nclauses, cypher_ast_foreach_get_clause),
+  List(&CYPHER_AST_WITH, "projections", cypher_ast_with_nprojections, cypher_ast_with_get_projection),
+  List(&CYPHER_AST_CALL, "args", cypher_ast_call_narguments, cypher_ast_call_get_argument),
+  List(&CYPHER_AST_CALL, "projections", cypher_ast_call_nprojections, cypher_ast_call_get_projection),
+  List(&CYPHER_AST_RETURN, "projections", cypher_ast_return_nprojections, cypher_ast_return_get_projection),
+  List(&CYPHER_AST_ORDER_BY, "items", cypher_ast_order_by_nitems, cypher_ast_order_by_get_item),
+  List(&CYPHER_AST_COMPARISON, "args", ComparisonArguments, cypher_ast_comparison_get_argument),
+  List(&CYPHER_AST_APPLY_OPERATOR, "args", cypher_ast_apply_operator_narguments, cypher_ast_apply_operator_get_argument),
+  List(&CYPHER_AST_MAP_PROJECTION, "selectors", cypher_ast_map_projection_nselectors, cypher_ast_map_projection_get_selector),
+  List(&CYPHER_AST_LABELS_OPERATOR, "labels", cypher_ast_labels_operator_nlabels, cypher_ast_labels_operator_get_label),
+  List(&CYPHER_AST_COLLECTION, "elements", cypher_ast_collection_length, cypher_ast_collection_get),
+  List(&CYPHER_AST_PATTERN, "paths", cypher_ast_pattern_npaths, cypher_ast_pattern_get_path),
+  List(&CYPHER_AST_NAMED_PATH, "elements", cypher_ast_pattern_path_nelements, cypher_ast_pattern_path_get_element),
+  List(&CYPHER_AST_SHORTEST_PATH, "elements", cypher_ast_pattern_path_nelements, cypher_ast_pattern_path_get_element),
+  List(&CYPHER_AST_PATTERN_PATH, "elements", cypher_ast_pattern_path_nelements, cypher_ast_pattern_path_get_element),
+  List(&CYPHER_AST_NODE_PATTERN, "labels", cypher_ast_node_pattern_nlabels, cypher_ast_node_pattern_get_label),
+  List(&CYPHER_AST_REL_PATTERN, "reltypes", cypher_ast_rel_pattern_nreltypes, cypher_ast_rel_pattern_get_reltype),
+  List(&CYPHER_AST_COMMAND, "args", cypher_ast_command_narguments, cypher_ast_command_get_argument),
+  Ops(&CYPHER_AST_COMPARISON, "ops", cypher_ast_comparison_get_length, cypher_ast_comparison_get_operator),
+  Pairs(&CYPHER_AST_CASE, "alternatives", cypher_ast_case_nalternatives, cypher_ast_case_get_predicate, cypher_ast_case_get_value),
+  Pairs(&CYPHER_AST_MAP, "entries", cypher_ast_map_nentries, cypher_ast_map_get_key, cypher_ast_map_get_value)
+};
+
+// Name or value of a node, NULL for nodes without one.
+static const char* NodeText(const cypher_astnode_t* node) {
+  auto type = cypher_astnode_type(node);
+  if (type == CYPHER_AST_TRUE)
+    return "true";
+  if (type == CYPHER_AST_FALSE)
+    return "false";
+  if (type == CYPHER_AST_NULL)
+    return "null";
+  for (auto& accessor : accessors) {
+    if (accessor.kind == AccessorKind::Text && *accessor.type == type)
+      return accessor.text(node);
+  }
+  return NULL;
+}
+
+// Matches text against a pattern where * stands for any text.
+static bool Glob(const char* pattern, const char* text) {
+  const char* star = NULL;
+  const char* resume = NULL;
+  while (*text) {
+    if (*pattern == '*') {
+      star = pattern++;
+      resume = text;
+    }
+    else if (*pattern == *text) {
+      pattern++;
+      text++;
+    }
+    else if (star) {
+      pattern = star + 1;
+      text = ++resume;
+    }
+    else
+      return false;
+  }
+  while (*pattern == '*')
+    pattern++;
+  return !*pattern;
+}
+
+bool Selector::Attribute::Matches(const cypher_astnode_t* node) const {
+  auto type = cypher_astnode_type(node);
+  for (auto accessor : accessors) {
+    if (*accessor->type != type)
+      continue;
+
+    switch (accessor->kind) {
+    case AccessorKind::Text: {
+      auto text = accessor->text(node);
+      return text && (!hasValue || Glob(value.c_str(), text));
+    }
+    case AccessorKind::Flag: {
+      auto flag = accessor->flag(node);
+      return hasValue ? Glob(value.c_str(), flag ? "true" : "false") : flag;
+    }
+    case AccessorKind::Number:
+      return !hasValue || Glob(value.c_str(), std::to_string(accessor->number(node)).c_str());
+    case AccessorKind::Op: {
+      auto name = OperatorName(accessor->op(node));
+      return name && (!hasValue || Glob(value.c_str(), name));
+    }
+    case AccessorKind::Child: {
+      auto child = accessor->child(node);
+      if (!child || !hasValue)
+        return child != NULL;
+      auto text = NodeText(child);
+      return text && Glob(value.c_str(), text);
+    }
+    case AccessorKind::List: {
+      auto count = accessor->count(node);
+      if (!hasValue)
+        return count > 0;
+      for (unsigned int i = 0; i < count; i++) {
+        auto element = accessor->element(node, i);
+        auto text = element ? NodeText(element) : NULL;
+        if (text && Glob(value.c_str(), text))
+          return true;
+      }
+      return false;
+    }
+    case AccessorKind::Ops: {
+      auto count = accessor->count(node);
+      if (!hasValue)
+        return count > 0;
+      for (unsigned int i = 0; i < count; i++) {
+        auto name = OperatorName(accessor->opElement(node, i));
+        if (name && Glob(value.c_str(), name))
+          return true;
+      }
+      return false;
+    }
+    case AccessorKind::Pairs: {
+      auto count = accessor->count(node);
+      if (!hasValue)
+        return count > 0;
+      for (unsigned int i = 0; i < count; i++) {
+        for (auto member : { accessor->element(node, i), accessor->value(node, i) }) {
+          auto text = member ? NodeText(member) : NULL;
+          if (text && Glob(value.c_str(), text))
+            return true;
+        }
+      }
+      return false;
+    }
+    }
+  }
+  return false;
+}
+
+bool Selector::Compound::Matches(const cypher_astnode_t* node) const {
+  if (!any && !types.Contains(cypher_astnode_type(node)))
+    return false;
+  for (auto& attribute : attributes) {
+    if (!attribute.Matches(node))
+      return false;
+  }
+  return true;
+}
+
+// Matches compounds right to left, the last one against the node, and the ones before it
+// against its parent or any of its ancestors.
+bool Selector::MatchFrom(const Complex& complex, size_t compound, const std::vector<const cypher_astnode_t*>& path,
+                         size_t depth) {
+  if (!complex[compound].Matches(path[depth]))
+    return false;
+  if (compound == 0)
+    return true;
+  if (complex[compound].child)
+    return depth > 0 && MatchFrom(complex, compound - 1, path, depth - 1);
+  for (size_t ancestor = depth; ancestor > 0; ancestor--) {
+    if (MatchFrom(complex, compound - 1, path, ancestor - 1))
+      return true;
+  }
+  return false;
+}
+
+bool Selector::Matches(const std::vector<const cypher_astnode_t*>& path) const {
+  if (path.empty())
+    return false;
+  for (auto& complex : alternatives) {
+    if (MatchFrom(complex, complex.size() - 1, path, path.size() - 1))
+      return true;
+  }
+  return false;
+}
+
+static std::string ReadName(const std::string& text, size_t& i, const char* extra) {
+  auto start = i;
+  while (i < text.length() && (isalnum((unsigned char)text[i]) || strchr(extra, text[i])))
+    i++;
+  return text.substr(start, i - start);
+}
+
+static std::string At(size_t i) {
+  return " at offset " + std::to_string(i) + ".";
+}
+
+std::shared_ptr<const Selector> Selector::Compile(const std::string& text, std::string& error) {
+  auto selector = std::make_shared<Selector>();
+  selector->text = text;
+
+  Complex complex;
+  bool child = false;
+  size_t i = 0;
+  for (;;) {
+    while (i < text.length() && isspace((unsigned char)text[i]))
+      i++;
+    if (i == text.length())
+      break;
+
+    if (text[i] == ',' || text[i] == '>') {
+      if (complex.empty() || child) {
+        error = std::string("Expected a node type") + At(i);
+        return NULL;
+      }
+      if (text[i] == ',') {
+        selector->alternatives.push_back(complex);
+        complex.clear();
+      }
+      else
+        child = true;
+      i++;
+      continue;
+    }
+
+    Compound compound;
+    compound.child = child;
+    child = false;
+    compound.any = text[i] == '*';
+    if (compound.any)
+      i++;
+    else {
+      auto start = i;
+      auto name = ReadName(text, i, "-");
+      if (name.empty()) {
+        error = std::string("Expected a node type") + At(start);
+        return NULL;
+      }
+      if (!compound.types.Add(name.c_str())) {
+        error = "Unknown node type " + name + At(start);
+        return NULL;
+      }
+    }
+
+    while (i < text.length() && text[i] == '[') {
+      Attribute attribute;
+      auto start = ++i;
+      attribute.name = ReadName(text, i, "");
+      for (auto& accessor : accessors) {
+        if (attribute.name == accessor.name && (compound.any || compound.types.Contains(*accessor.type)))
+          attribute.accessors.push_back(&accessor);
+      }
+      if (attribute.accessors.empty()) {
+        error = "Unknown attribute " + attribute.name + At(start);
+        return NULL;
+      }
+
+      attribute.hasValue = i < text.length() && text[i] == '=';
+      if (attribute.hasValue) {
+        i++;
+        if (i < text.length() && (text[i] == '"' || text[i] == '\'')) {
+          auto end = text.find(text[i], i + 1);
+          if (end == std::string::npos) {
+            error = std::string("Unterminated string") + At(i);
+            return NULL;
+          }
+          attribute.value = text.substr(i + 1, end - i - 1);
+          i = end + 1;
+        }
+        else {
+          auto end = text.find(']', i);
+          attribute.value = text.substr(i, end == std::string::npos ? std::string::npos : end - i);
+          i = end == std::string::npos ? text.length() : end;
+        }
+      }
+
+      if (i == text.length() || text[i] != ']') {
+        error = std::string("Expected ]") + At(i);
+        return NULL;
+      }
+      i++;
+      compound.attributes.push_back(attribute);
+    }
+
+    if (i < text.length() && !isspace((unsigned char)text[i]) && text[i] != ',' && text[i] != '>') {
+      error = std::string("Unexpected character") + At(i);
+      return NULL;
+    }
+    complex.push_back(compound);
+  }
+
+  if (complex.empty() || child) {
+    error = "Selector ends without a node type.";
+    return NULL;
+  }
+  selector->alternatives.push_back(complex);
+  return selector;
+}
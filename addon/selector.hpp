@@ -0,0 +1,61 @@
+#ifndef __SELECTOR_HPP__
+#define __SELECTOR_HPP__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cypher-parser.h>
+#include "visit.hpp"
+
+struct AttributeAccessor;
+
+// Selector over the libcypher-parser AST, as in CSS: node type names or * with attribute
+// conditions, separated by > for children and by spaces for descendants, and lists of
+// them separated by commas. Attributes are the members of the node in parse results.
+// [name] holds when the member is true, set, or a non-empty list, and [name=value] when
+// the name or value of the member, of an element of it, or of the key or value of one of
+// its entries, matches value, where * stands for any text. Operators match by their name.
+// A selector is compiled once and then matched read only from any thread.
+//
+//   match > pattern rel-pattern[varLength]
+//   apply-operator[funcName=apoc.*], call[procName=db.*]
+class Selector {
+public:
+  // Returns NULL with an error message for invalid selectors.
+  static std::shared_ptr<const Selector> Compile(const std::string& text, std::string& error);
+
+  // Whether the last node of a path from a root node matches.
+  bool Matches(const std::vector<const cypher_astnode_t*>& path) const;
+  const std::string& Text() const { return text; }
+
+private:
+  struct Attribute {
+    std::string name;
+    bool hasValue;
+    std::string value;
+    // Accessors of the node types having the member.
+    std::vector<const AttributeAccessor*> accessors;
+
+    bool Matches(const cypher_astnode_t* node) const;
+  };
+
+  struct Compound {
+    bool any;
+    NodeTypeSet types;
+    std::vector<Attribute> attributes;
+    // Whether the compound before this one must be the parent, instead of an ancestor.
+    bool child;
+
+    bool Matches(const cypher_astnode_t* node) const;
+  };
+
+  typedef std::vector<Compound> Complex;
+
+  static bool MatchFrom(const Complex& complex, size_t compound, const std::vector<const cypher_astnode_t*>& path,
+                        size_t depth);
+
+  std::string text;
+  std::vector<Complex> alternatives;
+};
+
+#endif //__SELECTOR_HPP__
@@ -0,0 +1,55 @@
+#ifndef __SINK_HPP__
+#define __SINK_HPP__
+
+#include <cstdint>
+#include "rapidjson/rapidjson.h"
+
+// Receives a parse result as it is walked, as SAX events following the rapidjson handler
+// concept, so the same walk can build a DOM, write json text or encode binary formats, and a
+// built DOM can be replayed into a sink with Accept.
+class ResultSink {
+public:
+  virtual ~ResultSink() {}
+
+  virtual bool Null() = 0;
+  virtual bool Bool(bool b) = 0;
+  virtual bool Int(int i) = 0;
+  virtual bool Uint(unsigned u) = 0;
+  virtual bool Int64(int64_t i) = 0;
+  virtual bool Uint64(uint64_t u) = 0;
+  virtual bool Double(double d) = 0;
+  virtual bool RawNumber(const char* str, rapidjson::SizeType length, bool copy) = 0;
+  virtual bool String(const char* str, rapidjson::SizeType length, bool copy) = 0;
+  virtual bool StartObject() = 0;
+  virtual bool Key(const char* str, rapidjson::SizeType length, bool copy) = 0;
+  virtual bool EndObject(rapidjson::SizeType memberCount) = 0;
+  virtual bool StartArray() = 0;
+  virtual bool EndArray(rapidjson::SizeType elementCount) = 0;
+};
+
+// Forwards to a rapidjson handler, as a Document or a Writer.
+template <class Handler>
+class HandlerSink : public ResultSink {
+public:
+  explicit HandlerSink(Handler& handler): handler(handler) {}
+
+  bool Null() { return handler.Null(); }
+  bool Bool(bool b) { return handler.Bool(b); }
+  bool Int(int i) { return handler.Int(i); }
+  bool Uint(unsigned u) { return handler.Uint(u); }
+  bool Int64(int64_t i) { return handler.Int64(i); }
+  bool Uint64(uint64_t u) { return handler.Uint64(u); }
+  bool Double(double d) { return handler.Double(d); }
+  bool RawNumber(const char* str, rapidjson::SizeType length, bool copy) { return handler.RawNumber(str, length, copy); }
+  bool String(const char* str, rapidjson::SizeType length, bool copy) { return handler.String(str, length, copy); }
+  bool StartObject() { return handler.StartObject(); }
+  bool Key(const char* str, rapidjson::SizeType length, bool copy) { return handler.Key(str, length, copy); }
+  bool EndObject(rapidjson::SizeType memberCount) { return handler.EndObject(memberCount); }
+  bool StartArray() { return handler.StartArray(); }
+  bool EndArray(rapidjson::SizeType elementCount) { return handler.EndArray(elementCount); }
+
+private:
+  Handler& handler;
+};
+
+#endif //__SINK_HPP__
@@ -0,0 +1,25 @@
+#include "summary.hpp"
+#include "ast.hpp"
+
+bool Summarize(QuerySummary& summary, const char* query, size_t length, const ParseOptions& options) {
+  ParsedQuery parsed(query, length, options);
+  if (!parsed.Parsed())
+    return false;
+
+  summary.nErrors = parsed.Errors();
+  parsed.ForEachNode([&](const cypher_astnode_t* node) {
+    auto type = cypher_astnode_type(node);
+    if (type == CYPHER_AST_LABEL)
+      summary.labels.insert(cypher_ast_label_get_name(node));
+    else if (type == CYPHER_AST_RELTYPE)
+      summary.relTypes.insert(cypher_ast_reltype_get_name(node));
+    else if (type == CYPHER_AST_PROP_NAME)
+      summary.propertyKeys.insert(cypher_ast_prop_name_get_value(node));
+    else if (type == CYPHER_AST_PROC_NAME)
+      summary.procedures.insert(cypher_ast_proc_name_get_value(node));
+    else if (type == CYPHER_AST_PARAMETER)
+      summary.parameters.insert(cypher_ast_parameter_get_name(node));
+    return true;
+  });
+  return true;
+}
@@ -0,0 +1,21 @@
+#ifndef __SUMMARY_HPP__
+#define __SUMMARY_HPP__
+
+#include <string>
+#include <unordered_set>
+#include "parser.hpp"
+
+// Names a query refers to, as an authorization layer checks them.
+struct QuerySummary {
+  std::unordered_set<std::string> labels;
+  std::unordered_set<std::string> relTypes;
+  std::unordered_set<std::string> propertyKeys;
+  std::unordered_set<std::string> procedures;
+  std::unordered_set<std::string> parameters;
+  unsigned int nErrors = 0;
+};
+
+// Collects the summary in one pass over the AST, without building a result tree.
+bool Summarize(QuerySummary& summary, const char* query, size_t length, const ParseOptions& options);
+
+#endif //__SUMMARY_HPP__
@@ -0,0 +1,64 @@
+#include "utf16.hpp"
+#include <algorithm>
+
+size_t SequenceLength(unsigned char c) {
+  if (c >= 0xF0)
+    return 4;
+  else if (c >= 0xE0)
+    return 3;
+  else if (c >= 0xC0)
+    return 2;
+  return 1;
+}
+
+void Utf16Index::Build(const char* query, size_t length) {
+  checkpoints.clear();
+  size_t excess = 0;
+
+  for (size_t i = 0; i < length;) {
+    auto c = (unsigned char)query[i];
+    if (c < 0x80) {
+      i++;
+      continue;
+    }
+
+    auto bytes = std::min(SequenceLength(c), length - i);
+    excess += bytes - (bytes == 4 ? 2 : 1);
+    i += bytes;
+    checkpoints.emplace_back(i, excess);
+  }
+}
+
+size_t Utf16Index::Map(size_t offset) const {
+  auto next = std::upper_bound(checkpoints.begin(), checkpoints.end(), std::make_pair(offset, (size_t)-1));
+  if (next == checkpoints.begin())
+    return offset;
+  return offset - (next - 1)->second;
+}
+
+struct cypher_input_position Utf16Index::Map(struct cypher_input_position position) const {
+  auto lineStart = Map(position.offset - (position.column - 1));
+  position.offset = Map(position.offset);
+  position.column = (unsigned int)(position.offset - lineStart + 1);
+  return position;
+}
+
+size_t Utf16Index::Unmap(size_t offset) const {
+  auto next = std::upper_bound(checkpoints.begin(), checkpoints.end(), offset,
+    [](size_t offset, const std::pair<size_t, size_t>& checkpoint) {
+      return offset < checkpoint.first - checkpoint.second;
+    });
+  if (next == checkpoints.begin())
+    return offset;
+  return offset + (next - 1)->second;
+}
+
+size_t Utf16Index::Length(const char* text, size_t length) {
+  size_t units = 0;
+  for (size_t i = 0; i < length;) {
+    auto bytes = std::min(SequenceLength((unsigned char)text[i]), length - i);
+    units += bytes == 4 ? 2 : 1;
+    i += bytes;
+  }
+  return units;
+}
@@ -0,0 +1,27 @@
+#ifndef __UTF16_HPP__
+#define __UTF16_HPP__
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include <cypher-parser.h>
+
+// Maps utf-8 byte offsets of a query to utf-16 code unit offsets, as used by js strings.
+// A checkpoint is only recorded after each non-ascii character, so ascii input costs
+// a single scan and no memory.
+class Utf16Index {
+public:
+  void Build(const char* query, size_t length);
+  size_t Map(size_t offset) const;
+  struct cypher_input_position Map(struct cypher_input_position position) const;
+  size_t Unmap(size_t offset) const;
+
+  static size_t Length(const char* text, size_t length);
+
+private:
+  // Byte offset following a non-ascii character, and the number of bytes in excess of
+  // code units up to that offset.
+  std::vector<std::pair<size_t, size_t>> checkpoints;
+};
+
+#endif //__UTF16_HPP__
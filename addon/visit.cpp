@@ -0,0 +1,177 @@
+#include "visit.hpp"
+#include <cstring>
+
+struct NodeTypeEntry {
+  const char* name;
+  const cypher_astnode_type_t* type;
+};
+
+// Type names written by the walk of each node type.
+static const NodeTypeEntry nodeTypeNames[] = {
+  { "statement", &CYPHER_AST_STATEMENT },
+  { "statement-option", &CYPHER_AST_STATEMENT_OPTION },
+  { "cypher-option", &CYPHER_AST_CYPHER_OPTION },
+  { "cypher-option-param", &CYPHER_AST_CYPHER_OPTION_PARAM },
+  { "statement-option", &CYPHER_AST_EXPLAIN_OPTION },
+  { "statement-option", &CYPHER_AST_PROFILE_OPTION },
+  { "create-node-prop-index", &CYPHER_AST_CREATE_NODE_PROP_INDEX },
+  { "drop-node-prop-index", &CYPHER_AST_DROP_NODE_PROP_INDEX },
+  { "create-node-prop-constraint", &CYPHER_AST_CREATE_NODE_PROP_CONSTRAINT },
+  { "drop-node-prop-constraint", &CYPHER_AST_DROP_NODE_PROP_CONSTRAINT },
+  { "create-rel-prop-constraint", &CYPHER_AST_CREATE_REL_PROP_CONSTRAINT },
+  { "drop-rel-prop-constraint", &CYPHER_AST_DROP_REL_PROP_CONSTRAINT },
+  { "query", &CYPHER_AST_QUERY },
+  { "using-periodic-commit", &CYPHER_AST_USING_PERIODIC_COMMIT },
+  { "load-csv", &CYPHER_AST_LOAD_CSV },
+  { "start", &CYPHER_AST_START },
+  { "node-index-lookup", &CYPHER_AST_NODE_INDEX_LOOKUP },
+  { "node-index-query", &CYPHER_AST_NODE_INDEX_QUERY },
+  { "node-id-lookup", &CYPHER_AST_NODE_ID_LOOKUP },
+  { "all-nodes-scan", &CYPHER_AST_ALL_NODES_SCAN },
+  { "rel-index-lookup", &CYPHER_AST_REL_INDEX_LOOKUP },
+  { "rel-index-query", &CYPHER_AST_REL_INDEX_QUERY },
+  { "rel-id-lookup", &CYPHER_AST_REL_ID_LOOKUP },
+  { "all-rels-scan", &CYPHER_AST_ALL_RELS_SCAN },
+  { "match", &CYPHER_AST_MATCH },
+  { "using-index", &CYPHER_AST_USING_INDEX },
+  { "using-join", &CYPHER_AST_USING_JOIN },
+  { "using-scan", &CYPHER_AST_USING_SCAN },
+  { "merge", &CYPHER_AST_MERGE },
+  { "on-match", &CYPHER_AST_ON_MATCH },
+  { "on-create", &CYPHER_AST_ON_CREATE },
+  { "create", &CYPHER_AST_CREATE },
+  { "set", &CYPHER_AST_SET },
+  { "set-property", &CYPHER_AST_SET_PROPERTY },
+  { "set-all-properties", &CYPHER_AST_SET_ALL_PROPERTIES },
+  { "merge-properties", &CYPHER_AST_MERGE_PROPERTIES },
+  { "set-labels", &CYPHER_AST_SET_LABELS },
+  { "delete", &CYPHER_AST_DELETE },
+  { "remove", &CYPHER_AST_REMOVE },
+  { "remove-labels", &CYPHER_AST_REMOVE_LABELS },
+  { "remove-property", &CYPHER_AST_REMOVE_PROPERTY },
+  { "for-each", &CYPHER_AST_FOREACH },
+  { "with", &CYPHER_AST_WITH },
+  { "unwind", &CYPHER_AST_UNWIND },
+  { "call", &CYPHER_AST_CALL },
+  { "return", &CYPHER_AST_RETURN },
+  { "projection", &CYPHER_AST_PROJECTION },
+  { "order-by", &CYPHER_AST_ORDER_BY },
+  { "sort-item", &CYPHER_AST_SORT_ITEM },
+  { "union", &CYPHER_AST_UNION },
+  { "unary-operator", &CYPHER_AST_UNARY_OPERATOR },
+  { "binary-operator", &CYPHER_AST_BINARY_OPERATOR },
+  { "comparison", &CYPHER_AST_COMPARISON },
+  { "apply-operator", &CYPHER_AST_APPLY_OPERATOR },
+  { "apply-all-operator", &CYPHER_AST_APPLY_ALL_OPERATOR },
+  { "property-operator", &CYPHER_AST_PROPERTY_OPERATOR },
+  { "subscript-operator", &CYPHER_AST_SUBSCRIPT_OPERATOR },
+  { "slice-operator", &CYPHER_AST_SLICE_OPERATOR },
+  { "map-projection", &CYPHER_AST_MAP_PROJECTION },
+  { "map-projection-literal", &CYPHER_AST_MAP_PROJECTION_LITERAL },
+  { "map-projection-property", &CYPHER_AST_MAP_PROJECTION_PROPERTY },
+  { "map-projection-identifier", &CYPHER_AST_MAP_PROJECTION_IDENTIFIER },
+  { "map-projection-all-properties", &CYPHER_AST_MAP_PROJECTION_ALL_PROPERTIES },
+  { "labels-operator", &CYPHER_AST_LABELS_OPERATOR },
+  { "list-comprehension", &CYPHER_AST_LIST_COMPREHENSION },
+  { "pattern-comprehension", &CYPHER_AST_PATTERN_COMPREHENSION },
+  { "case", &CYPHER_AST_CASE },
+  { "filter", &CYPHER_AST_FILTER },
+  { "extract", &CYPHER_AST_EXTRACT },
+  { "reduce", &CYPHER_AST_REDUCE },
+  { "all", &CYPHER_AST_ALL },
+  { "any", &CYPHER_AST_ANY },
+  { "single", &CYPHER_AST_SINGLE },
+  { "none", &CYPHER_AST_NONE },
+  { "collection", &CYPHER_AST_COLLECTION },
+  { "map", &CYPHER_AST_MAP },
+  { "identifier", &CYPHER_AST_IDENTIFIER },
+  { "parameter", &CYPHER_AST_PARAMETER },
+  { "string", &CYPHER_AST_STRING },
+  { "integer", &CYPHER_AST_INTEGER },
+  { "float", &CYPHER_AST_FLOAT },
+  { "true", &CYPHER_AST_TRUE },
+  { "false", &CYPHER_AST_FALSE },
+  { "null", &CYPHER_AST_NULL },
+  { "label", &CYPHER_AST_LABEL },
+  { "reltype", &CYPHER_AST_RELTYPE },
+  { "prop-name", &CYPHER_AST_PROP_NAME },
+  { "function-name", &CYPHER_AST_FUNCTION_NAME },
+  { "index-name", &CYPHER_AST_INDEX_NAME },
+  { "proc-name", &CYPHER_AST_PROC_NAME },
+  { "pattern", &CYPHER_AST_PATTERN },
+  { "named-path", &CYPHER_AST_NAMED_PATH },
+  { "shortest-path", &CYPHER_AST_SHORTEST_PATH },
+  { "pattern-path", &CYPHER_AST_PATTERN_PATH },
+  { "node-pattern", &CYPHER_AST_NODE_PATTERN },
+  { "rel-pattern", &CYPHER_AST_REL_PATTERN },
+  { "range", &CYPHER_AST_RANGE },
+  { "command", &CYPHER_AST_COMMAND },
+  { "line-comment", &CYPHER_AST_LINE_COMMENT },
+  { "block-comment", &CYPHER_AST_BLOCK_COMMENT },
+  { "error", &CYPHER_AST_ERROR },
+};
+
+const char* NodeTypeName(cypher_astnode_type_t type) {
+  for (auto& entry : nodeTypeNames) {
+    if (*entry.type == type)
+      return entry.name;
+  }
+  return NULL;
+}
+
+struct OperatorEntry {
+  const char* name;
+  const cypher_operator_t* const* op;
+};
+
+// Names written by the walk of each operator.
+static const OperatorEntry operatorNames[] = {
+  { "or", &CYPHER_OP_OR },
+  { "xor", &CYPHER_OP_XOR },
+  { "and", &CYPHER_OP_AND },
+  { "not", &CYPHER_OP_NOT },
+  { "equal", &CYPHER_OP_EQUAL },
+  { "not-equal", &CYPHER_OP_NEQUAL },
+  { "less-than", &CYPHER_OP_LT },
+  { "greater-than", &CYPHER_OP_GT },
+  { "less-than-equal", &CYPHER_OP_LTE },
+  { "greater-than-equal", &CYPHER_OP_GTE },
+  { "plus", &CYPHER_OP_PLUS },
+  { "minus", &CYPHER_OP_MINUS },
+  { "mult", &CYPHER_OP_MULT },
+  { "div", &CYPHER_OP_DIV },
+  { "mod", &CYPHER_OP_MOD },
+  { "pow", &CYPHER_OP_POW },
+  { "unary-plus", &CYPHER_OP_UNARY_PLUS },
+  { "unary-minus", &CYPHER_OP_UNARY_MINUS },
+  { "subscript", &CYPHER_OP_SUBSCRIPT },
+  { "map-projection", &CYPHER_OP_MAP_PROJECTION },
+  { "regex", &CYPHER_OP_REGEX },
+  { "in", &CYPHER_OP_IN },
+  { "starts-with", &CYPHER_OP_STARTS_WITH },
+  { "ends-with", &CYPHER_OP_ENDS_WITH },
+  { "contains", &CYPHER_OP_CONTAINS },
+  { "is-null", &CYPHER_OP_IS_NULL },
+  { "is-not-null", &CYPHER_OP_IS_NOT_NULL },
+  { "property", &CYPHER_OP_PROPERTY },
+  { "label", &CYPHER_OP_LABEL },
+};
+
+const char* OperatorName(const cypher_operator_t* op) {
+  for (auto& entry : operatorNames) {
+    if (*entry.op == op)
+      return entry.name;
+  }
+  return NULL;
+}
+
+bool NodeTypeSet::Add(const char* name) {
+  bool found = false;
+  for (auto& entry : nodeTypeNames) {
+    if (!strcmp(entry.name, name)) {
+      types.set(*entry.type);
+      found = true;
+    }
+  }
+  return found;
+}
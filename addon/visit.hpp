@@ -0,0 +1,26 @@
+#ifndef __VISIT_HPP__
+#define __VISIT_HPP__
+
+#include <bitset>
+#include <cstdint>
+#include <cypher-parser.h>
+
+// Set of AST node types, by the type names of parse results. Explain and profile options
+// are both statement-option nodes, so that name stands for the three of them.
+class NodeTypeSet {
+public:
+  // Returns false for names no node type has.
+  bool Add(const char* name);
+  bool Contains(cypher_astnode_type_t type) const { return types.test(type); }
+  bool Empty() const { return types.none(); }
+
+private:
+  std::bitset<UINT8_MAX + 1> types;
+};
+
+// Type name of a node type, as written by the walk. NULL for types the walk does not write.
+const char* NodeTypeName(cypher_astnode_type_t type);
+// Name of an operator, as written by the walk. NULL for unknown operators.
+const char* OperatorName(const cypher_operator_t* op);
+
+#endif //__VISIT_HPP__
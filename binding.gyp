@@ -1,59 +1,105 @@
 {
+  "target_defaults": {
+    "include_dirs": [
+      "/usr/local/include"
+    ],
+    "cflags!": [ "-fno-exceptions" ],
+    'cflags_cc!': [ '-fno-exceptions' ],
+    "conditions": [
+      ["OS=='linux' or OS=='freebsd' or OS=='openbsd' or OS=='solaris'", {
+          "cflags": ["-Wall", "-Wextra", "-pedantic"],
+          "cflags_cc": ["-std=c++14"],
+          'cflags_cc!': [ '-fno-rtti' ]
+      }],
+      ['OS=="mac"', {
+        'defines': [
+          'TMPFILE_AST=1'
+        ],
+        'xcode_settings': {
+          'ALWAYS_SEARCH_USER_PATHS': 'NO',
+          'GCC_CW_ASM_SYNTAX': 'NO',                # No -fasm-blocks
+          'GCC_DYNAMIC_NO_PIC': 'NO',               # No -mdynamic-no-pic
+                                                    # (Equivalent to -fPIC)
+          'GCC_ENABLE_CPP_EXCEPTIONS': 'YES',       # -fno-exceptions
+          'GCC_ENABLE_CPP_RTTI': 'NO',              # -fno-rtti
+          'GCC_ENABLE_PASCAL_STRINGS': 'NO',        # No -mpascal-strings
+          'GCC_THREADSAFE_STATICS': 'NO',           # -fno-threadsafe-statics
+          'GCC_VERSION': '6',
+          'GCC_WARN_ABOUT_MISSING_NEWLINE': 'NO',  # -Wnewline-eof
+          'PREBINDING': 'NO',                       # No -Wl,-prebind
+          'USE_HEADERMAP': 'NO',
+          'OTHER_CFLAGS': [
+            '-fno-strict-aliasing',
+          ],
+          'WARNING_CFLAGS': [
+            '-Wall',
+            '-Wendif-labels',
+            '-W',
+            '-Wno-unused-parameter'
+          ],
+        }
+      }]
+    ]
+  },
   "targets": [
+    {
+      "target_name": "cypher_bin",
+      "type": "static_library",
+      "sources": [
+        "addon/parser.cpp",
+        "addon/utf16.cpp",
+        "addon/document.cpp",
+        "addon/handle.cpp",
+        "addon/names.cpp",
+        "addon/binary.cpp",
+        "addon/cbor.cpp",
+        "addon/ast.cpp",
+        "addon/summary.cpp",
+        "addon/classify.cpp",
+        "addon/cost.cpp",
+        "addon/lint.cpp",
+        "addon/schema.cpp",
+        "addon/scopes.cpp",
+        "addon/visit.cpp",
+        "addon/selector.cpp",
+        "addon/rewrite.cpp",
+        "addon/normalize.cpp",
+        "addon/fingerprint.cpp",
+        "addon/memstream/memstream.c"
+      ],
+      "cflags": ["-fPIC"],
+      "direct_dependent_settings": {
+        "include_dirs": [
+          "addon",
+          "/usr/local/include"
+        ]
+      },
+      "link_settings": {
+        "libraries": [
+          "/usr/local/lib/libcypher-parser.a", "-L/usr/lib"
+        ]
+      }
+    },
     {
       "target_name": "cypher",
+      "dependencies": [ "cypher_bin" ],
       "sources": [
         "addon/binding.cpp",
-        "addon/parser.cpp",
-        "addon/memstream/memstream.c",
-        "addon/fmemopen/fmemopen.c"
+        "addon/keys.cpp"
       ],
       "include_dirs": [
-        "<!(node -e \"require('nan')\")", 
-        "/usr/local/include"
-      ],
-      "libraries": [
-        "/usr/local/lib/libcypher-parser.a", "-L/usr/lib"
-      ],
-      "cflags!": [ "-fno-exceptions" ],
-      'cflags_cc!': [ '-fno-exceptions' ],
-      "conditions": [
-        ["OS=='linux' or OS=='freebsd' or OS=='openbsd' or OS=='solaris'", {
-            "cflags": ["-Wall", "-Wextra", "-pedantic"],
-            "cflags_cc": ["-std=c++14"],
-            'cflags_cc!': [ '-fno-rtti' ]
-        }],
-        ['OS=="mac"', {
-          'defines': [
-            'CUSTOM_FMEMOPEN=1',
-            'TMPFILE_AST=1'
-          ],
-          'xcode_settings': {
-            'ALWAYS_SEARCH_USER_PATHS': 'NO',
-            'GCC_CW_ASM_SYNTAX': 'NO',                # No -fasm-blocks
-            'GCC_DYNAMIC_NO_PIC': 'NO',               # No -mdynamic-no-pic
-                                                      # (Equivalent to -fPIC)
-            'GCC_ENABLE_CPP_EXCEPTIONS': 'YES',       # -fno-exceptions
-            'GCC_ENABLE_CPP_RTTI': 'NO',              # -fno-rtti
-            'GCC_ENABLE_PASCAL_STRINGS': 'NO',        # No -mpascal-strings
-            'GCC_THREADSAFE_STATICS': 'NO',           # -fno-threadsafe-statics
-            'GCC_VERSION': '6',
-            'GCC_WARN_ABOUT_MISSING_NEWLINE': 'NO',  # -Wnewline-eof
-            'PREBINDING': 'NO',                       # No -Wl,-prebind
-            'USE_HEADERMAP': 'NO',
-            'OTHER_CFLAGS': [
-              '-fno-strict-aliasing',
-            ],
-            'WARNING_CFLAGS': [
-              '-Wall',
-              '-Wendif-labels',
-              '-W',
-              '-Wno-unused-parameter'
-            ],
-          }
-        }]
+        "<!(node -e \"require('nan')\")"
       ]
     },
+    {
+      "target_name": "cypher-parse",
+      "type": "executable",
+      "dependencies": [ "cypher_bin" ],
+      "sources": [
+        "cli/main.cpp"
+      ],
+      "ldflags": [ "-pthread" ]
+    },
     {
       "target_name": "action_after_build",
       "type": "none",
@@ -66,4 +112,4 @@
       ]
     }
   ]
-}
\ No newline at end of file
+}
@@ -0,0 +1,144 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "cbor.hpp"
+#include "parser.hpp"
+#include "pool.hpp"
+#include "rapidjson/document.h"
+
+const char* usage =
+  "usage: cypher-parse [options] < queries > results\n"
+  "\n"
+  "Parses one query per input line and writes one json result per output line, in input order.\n"
+  "With --cbor, results are written as a CBOR sequence instead.\n"
+  "\n"
+  "options:\n"
+  "  --ndjson          Input lines are json strings, or objects with a query property.\n"
+  "  --threads <n>     Number of parsing threads. Default is the number of cores.\n"
+  "  --batch <n>       Number of lines parsed between two writes. Default 65536.\n"
+  "  --dump-ast        Add a text description of the AST to results.\n"
+  "  --width <n>       Width of the text AST output. Default 0.\n"
+  "  --commands        Parse client commands too.\n"
+  "  --compact         Write compact results, with short keys and type ids.\n"
+  "  --cbor            Write CBOR results, encoded while walking the AST.\n";
+
+struct Line {
+  std::string input;
+  std::string output;
+};
+
+bool GetQuery(const std::string& line, bool ndjson, std::string& query) {
+  if (!ndjson) {
+    query = line;
+    return true;
+  }
+
+  rapidjson::Document document;
+  document.Parse(line.c_str(), line.length());
+  if (document.HasParseError())
+    return false;
+
+  if (document.IsString()) {
+    query.assign(document.GetString(), document.GetStringLength());
+    return true;
+  }
+
+  if (document.IsObject()) {
+    auto member = document.FindMember("query");
+    if (member != document.MemberEnd() && member->value.IsString()) {
+      query.assign(member->value.GetString(), member->value.GetStringLength());
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void WriteError(Line& line, bool cbor, const char* message) {
+  if (!cbor) {
+    line.output = std::string("{\"error\":\"") + message + "\"}";
+    return;
+  }
+
+  CborWriter writer(line.output);
+  writer.StartObject();
+  writer.Key("error", 5, false);
+  writer.String(message, (rapidjson::SizeType)strlen(message), false);
+  writer.EndObject(1);
+}
+
+void ParseLine(Line& line, bool ndjson, bool cbor, const ParseOptions& options) {
+  std::string query;
+  line.output.clear();
+  if (!GetQuery(line.input, ndjson, query)) {
+    WriteError(line, cbor, "Invalid input line.");
+    return;
+  }
+
+  if (cbor) {
+    CborWriter writer(line.output);
+    NodeBin::Parse(writer, query.c_str(), query.length(), options);
+  }
+  else
+    NodeBin::Parse(line.output, query.c_str(), query.length(), options);
+
+  if (line.output.empty())
+    WriteError(line, cbor, "Could not parse query.");
+}
+
+int main(int argc, char** argv) {
+  ParseOptions options;
+  bool ndjson = false;
+  bool cbor = false;
+  unsigned int nThreads = std::thread::hardware_concurrency();
+  size_t batchSize = 65536;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--ndjson"))
+      ndjson = true;
+    else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+      nThreads = (unsigned int)strtoul(argv[++i], NULL, 10);
+    else if (!strcmp(argv[i], "--batch") && i + 1 < argc)
+      batchSize = std::max((size_t)strtoul(argv[++i], NULL, 10), (size_t)1);
+    else if (!strcmp(argv[i], "--dump-ast"))
+      options.dumpAst = true;
+    else if (!strcmp(argv[i], "--width") && i + 1 < argc)
+      options.width = (unsigned int)strtoul(argv[++i], NULL, 10);
+    else if (!strcmp(argv[i], "--commands"))
+      options.parseOnlyStatements = false;
+    else if (!strcmp(argv[i], "--compact"))
+      options.compact = true;
+    else if (!strcmp(argv[i], "--cbor"))
+      cbor = true;
+    else {
+      std::cerr << usage;
+      return strcmp(argv[i], "--help") ? 1 : 0;
+    }
+  }
+
+  std::ios::sync_with_stdio(false);
+  WorkStealingPool pool(nThreads);
+  std::vector<Line> lines(batchSize);
+
+  while (std::cin) {
+    size_t nLines = 0;
+    while (nLines < batchSize && std::getline(std::cin, lines[nLines].input))
+      nLines++;
+
+    pool.Run(nLines, [&](size_t i) {
+      ParseLine(lines[i], ndjson, cbor, options);
+    });
+
+    for (size_t i = 0; i < nLines; i++) {
+      fwrite(lines[i].output.c_str(), 1, lines[i].output.length(), stdout);
+      if (!cbor)
+        fputc('\n', stdout);
+    }
+  }
+
+  fflush(stdout);
+  return 0;
+}
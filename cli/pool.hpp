@@ -0,0 +1,125 @@
+#ifndef __POOL_HPP__
+#define __POOL_HPP__
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs batches of tasks on a fixed number of threads, started once with the pool and
+// woken for each batch. Tasks are dealt in contiguous blocks to per-thread queues; a thread
+// pops from the front of its own queue, and steals from the back of the others' when it runs dry.
+class WorkStealingPool {
+public:
+  WorkStealingPool(unsigned int nThreads) {
+    for (unsigned int i = 0; i < std::max(nThreads, 1u); i++)
+      queues.emplace_back(new Queue());
+    for (unsigned int i = 1; i < queues.size(); i++)
+      threads.emplace_back(&WorkStealingPool::Work, this, i);
+  }
+
+  ~WorkStealingPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    started.notify_all();
+    for (auto& thread : threads)
+      thread.join();
+  }
+
+  // Returns once every task of the batch ran. The calling thread runs tasks too.
+  void Run(size_t nTasks, const std::function<void(size_t)>& task) {
+    if (!nTasks)
+      return;
+
+    size_t blockSize = nTasks / queues.size() + 1;
+    for (size_t i = 0; i < nTasks; i++)
+      queues[i / blockSize]->tasks.push_back(i);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      current = &task;
+      batch++;
+      running = threads.size();
+    }
+    started.notify_all();
+    Drain(0, task);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return running == 0; });
+    current = NULL;
+  }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+  };
+
+  void Drain(unsigned int self, const std::function<void(size_t)>& task) {
+    size_t index;
+    while (Pop(self, index) || Steal(self, index))
+      task(index);
+  }
+
+  void Work(unsigned int self) {
+    size_t done = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      started.wait(lock, [&] { return stopping || batch != done; });
+      if (stopping)
+        return;
+
+      done = batch;
+      auto task = current;
+      lock.unlock();
+      Drain(self, *task);
+      lock.lock();
+      if (--running == 0)
+        finished.notify_one();
+    }
+  }
+
+  bool Pop(unsigned int self, size_t& index) {
+    auto& queue = *queues[self];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+      return false;
+
+    index = queue.tasks.front();
+    queue.tasks.pop_front();
+    return true;
+  }
+
+  bool Steal(unsigned int self, size_t& index) {
+    for (size_t i = 1; i < queues.size(); i++) {
+      auto& queue = *queues[(self + i) % queues.size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.tasks.empty())
+        continue;
+
+      index = queue.tasks.back();
+      queue.tasks.pop_back();
+      return true;
+    }
+    return false;
+  }
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable started;
+  std::condition_variable finished;
+  // Task of the batch being run, and the number of threads still running it.
+  const std::function<void(size_t)>* current = NULL;
+  size_t batch = 0;
+  size_t running = 0;
+  bool stopping = false;
+};
+
+#endif //__POOL_HPP__
@@ -1,5 +1,6 @@
 export interface AstNode {
   type: string;
+  range?: [number, number]; // Start and end offsets of the node, when the ranges option is set.
 }
 
 export interface Parameter extends AstNode {
@@ -425,6 +426,8 @@ export interface Map extends Expression {
 
 export interface Identifier extends Expression {
   name: string;
+  // Offset of the identifier binding the variable, with the scopes option. Null when unbound.
+  binding?: number | null;
 }
 
 export interface String extends Expression {
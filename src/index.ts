@@ -2,6 +2,8 @@ const binary = require("@mapbox/node-pre-gyp");
 const path = require("path");
 const binding_path = binary.find(path.resolve(path.join(__dirname, "../package.json")));
 const cypher = require(binding_path);
+import { Readable } from "stream";
+import { TextDecoder } from "util";
 import * as ast from "./ast";
 
 export interface ParsePosition {
@@ -17,28 +19,217 @@ export interface ParseError {
   contextOffset: number;
 }
 
+export type LintRule = "missing-limit" | "leading-optional-match" | "start-clause" | "unbound-identifier" |
+  "unknown-label" | "unknown-rel-type" | "unknown-property" | "unbound-variable" | "shadowed-variable";
+
+export interface LintDiagnostic extends ParseError {
+  rule: LintRule;
+}
+
+export interface VariableBinding {
+  name: string;
+  kind: string;
+  position: ParsePosition;
+}
+
 export type parseResultDirective = ast.Statement|ast.Command;
 export interface ParseResult {
   ast: string;
   errors: ParseError[];
+  diagnostics?: LintDiagnostic[];
+  bindings?: VariableBinding[];
+  fingerprint?: string;
   directives: parseResultDirective[];
   roots: ast.AstNode[];
   nnodes: number;
 }
 
+/**
+ * Form of parse results. "json" is the result text, same as the rawJson option. "buffer" is utf-8
+ * json text and "binary" a compact binary tree, both in one ArrayBuffer that can be transferred
+ * between threads without copying, and read with decode. "cbor" is a Buffer holding CBOR.
+ */
+export type ResultFormat = "object" | "json" | "buffer" | "binary" | "cbor";
+
 export interface ParseParameters {
   query: string;
   width?: number;
   dumpAst?: boolean;
   rawJson?: boolean;
+  format?: ResultFormat;
   colorize?: boolean;
   parseOnlyStatements?: boolean;
+  threads?: number;
+  position?: ParsePosition;
+  ranges?: boolean;
+  fixedShapes?: boolean;
+  compact?: boolean;
+  lint?: LintRule[];
+  schema?: GraphSchema;
+  scopes?: boolean;
+  normalize?: boolean;
+}
+
+export interface SchemaDefinition {
+  labels?: {[label: string]: string[]};
+  relTypes?: {[relType: string]: string[]};
+}
+
+/**
+ * Schema compiled natively by compileSchema, with the number of labels, relationship types
+ * and distinct property keys it holds.
+ */
+export interface GraphSchema {
+  readonly labels: number;
+  readonly relTypes: number;
+  readonly properties: number;
+}
+
+/**
+ * Compiles labels, relationship types and their property keys once into perfect hash sets. Parses
+ * given the compiled schema as their schema option report names missing from it as diagnostics.
+ */
+export const compileSchema = (definition: SchemaDefinition): GraphSchema => new cypher.GraphSchema(definition);
+
+/**
+ * Selector compiled natively by compileSelector, with its text.
+ */
+export interface Selector {
+  readonly selector: string;
+}
+
+/**
+ * Compiles a selector over AST nodes once, to match it against any number of queries with select.
+ * Throws for invalid selectors, or node types and attributes that do not exist.
+ */
+export const compileSelector = (selector: string): Selector => new cypher.Selector(selector);
+
+export type StreamParameters = Omit<ParseParameters, "query" | "rawJson" | "format">;
+
+export interface ParseFileParameters extends Omit<ParseParameters, "query"> {
+  path: string;
+}
+
+export interface SplitParameters {
+  query: string;
+  parseOnlyStatements?: boolean;
+}
+
+export type AnalysisParameters = SplitParameters;
+
+export interface QuerySummary {
+  labels: string[];
+  relTypes: string[];
+  propertyKeys: string[];
+  procedures: string[];
+  parameters: string[];
+  errors: number;
+}
+
+export type QueryKind = "read" | "write" | "schema" | "procedure";
+
+export interface QueryClassification {
+  kind: QueryKind;
+  errors: number;
+}
+
+export interface CostWeights {
+  unboundedRange?: number;
+  rangeHop?: number;
+  cartesianProduct?: number;
+  unwindElement?: number;
+}
+
+export interface CostParameters extends AnalysisParameters {
+  weights?: CostWeights;
+}
+
+export interface CostFactor {
+  name: "unboundedRange" | "rangeHops" | "cartesianProducts" | "unwindElements";
+  count: number;
+  score: number;
+}
+
+export interface QueryCost {
+  score: number;
+  factors: CostFactor[];
+  errors: number;
+}
+
+export type VisitParameters = Pick<ParseParameters, "query" | "parseOnlyStatements" | "position" | "ranges" | "fixedShapes" | "compact">;
+
+export interface VisitOptions {
+  types: string[];
+}
+
+export interface VisitResult {
+  visited: number;
+  errors: ParseError[];
+}
+
+export interface SelectorMatch {
+  node: ast.AstNode;
+  path: string[];
+  selectors: number[];
+}
+
+export interface SelectResult {
+  matches: SelectorMatch[];
+  errors: ParseError[];
+}
+
+export type RewriteOperation =
+  {type: "add-predicate", predicate: string, selector?: Selector} |
+  {type: "add-label", label: string, selector?: Selector} |
+  {type: "rename", from: string, to: string, selector?: Selector};
+
+export interface RewriteResult {
+  query: string;
+  edits: number;
+  errors: number;
+}
+
+export interface QuerySegment {
+  start: number;
+  end: number;
+  text: string;
+  type: "statement" | "command";
+}
+
+export interface ParserParameters extends Omit<ParseParameters, "query" | "position"> {
+  maxQueryLength?: number;
+  cacheSize?: number;
+}
+
+export interface ParserMetrics {
+  parses: number;
+  cacheHits: number;
+  failures: number;
+  rejected: number;
+  bytes: number;
+  parseTime: number;
+}
+
+export type DocumentParameters = Omit<ParseParameters, "query" | "rawJson" | "format" | "threads" | "position">;
+
+export interface DocumentSegment {
+  start: number;
+  end: number;
+  position: ParsePosition;
+  type: "statement" | "command";
+  result: ParseResult;
+}
+
+export interface DocumentDelta {
+  index: number;
+  deleteCount: number;
+  segments: DocumentSegment[];
 }
 
 export class CypherParserError extends Error {
-  constructor(parseResult: ParseResult) {
+  constructor(parseResult: ParseResult | ArrayBuffer | Uint8Array) {
       super("Cypher Parser Error");
-      this.parseResult = parseResult;
+      this.parseResult = parseResult instanceof ArrayBuffer || parseResult instanceof Uint8Array ? decode(parseResult) : parseResult;
       Object.setPrototypeOf(this, CypherParserError.prototype);
   }
 
@@ -46,11 +237,569 @@ export class CypherParserError extends Error {
 }
 
 export const parse = (query: string | ParseParameters) => new Promise<ParseResult>((resolve, reject) =>
-  cypher.parse(function(succeeded: boolean, result: ParseResult) {
+  cypher.parse(function(succeeded: boolean, result: ParseResult | Error) {
     if (succeeded) {
-      resolve(result);
+      resolve(result as ParseResult);
+    } else if (result instanceof Error) {
+      reject(result);
     } else {
       reject(new CypherParserError(result));
     }
   }, query)
-);
\ No newline at end of file
+);
+
+/**
+ * Full names of the short keys, and of the type and operator ids, of compact results.
+ * Ids and keys only ever get added to, so a stored dictionary keeps decoding older results.
+ */
+export interface CompactDictionary {
+  keys: {[key: string]: string};
+  values: string[];
+}
+
+export const dictionary: CompactDictionary = cypher.dictionary;
+
+const expandNode = (node: any): any => {
+  if (Array.isArray(node)) {
+    return node.map(expandNode);
+  }
+  if (!node || typeof node !== "object") {
+    return node;
+  }
+  const expanded: any = {};
+  for (const key of Object.keys(node)) {
+    const name = dictionary.keys[key] || key;
+    const value = node[key];
+    if (name === "type" || name === "op") {
+      expanded[name] = typeof value === "number" ? dictionary.values[value] : value;
+    } else if (name === "ops") {
+      expanded[name] = value.map((op: any) => typeof op === "number" ? dictionary.values[op] : op);
+    } else if (name === "entries") {
+      // Map entry keys are property names from the query, not dictionary keys.
+      expanded[name] = {};
+      for (const entry of Object.keys(value)) {
+        expanded[name][entry] = expandNode(value[entry]);
+      }
+    } else {
+      expanded[name] = expandNode(value);
+    }
+  }
+  return expanded;
+};
+
+/**
+ * Restores full keys and type and operator names in a compact result. Omitted null members and empty arrays stay omitted.
+ */
+export const expand = (result: ParseResult): ParseResult =>
+  ({...result, roots: result.roots.map(expandNode), directives: result.directives.map(expandNode)});
+
+/**
+ * Parses to a buffer or binary result, to post to another thread with the buffer in the transfer list.
+ */
+export const parseTransferable = (query: ParseParameters & {format: "buffer" | "binary"}) =>
+  parse(query) as Promise<unknown> as Promise<ArrayBuffer>;
+
+/**
+ * Parses to CBOR, encoded while the AST is walked, for services reading results with any CBOR decoder.
+ */
+export const parseCbor = (query: string | ParseParameters) =>
+  parse(typeof query === "string" ? {query, format: "cbor"} : {...query, format: "cbor"}) as Promise<unknown> as Promise<Buffer>;
+
+const names: string[] = cypher.names;
+const textDecoder = new TextDecoder();
+
+const enum Tag {
+  Null, False, True, Int32, Double, Name, String, Array, Object, Range
+}
+
+// Start and end offsets of the node ranges of a binary result.
+interface RangeTables {
+  starts: Uint32Array;
+  ends: Uint32Array;
+}
+
+// Views the range tables at the end of a binary result, copied when not aligned in the buffer.
+const readRangeTables = (bytes: Uint8Array): RangeTables => {
+  const count = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength).getUint32(bytes.byteLength - 4, true);
+  const offset = bytes.byteLength - 4 - count * 8;
+  const tables = (bytes.byteOffset + offset) % 4 ? bytes.slice(offset, offset + count * 8) : bytes.subarray(offset, offset + count * 8);
+  return {
+    starts: new Uint32Array(tables.buffer, tables.byteOffset, count),
+    ends: new Uint32Array(tables.buffer, tables.byteOffset + count * 4, count)
+  };
+};
+
+// Reads the binary result layout described in addon/binary.hpp.
+class BinaryReader {
+  private view: DataView;
+
+  constructor(private bytes: Uint8Array, public offset: number, private ranges: RangeTables) {
+    this.view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+  }
+
+  public value(): any {
+    switch (this.bytes[this.offset++]) {
+      case Tag.False:
+        return false;
+      case Tag.True:
+        return true;
+      case Tag.Int32:
+        this.offset += 4;
+        return this.view.getInt32(this.offset - 4, true);
+      case Tag.Double:
+        this.offset += 8;
+        return this.view.getFloat64(this.offset - 8, true);
+      case Tag.Name:
+        return names[this.uvarint()];
+      case Tag.String:
+        return this.text(this.uvarint());
+      case Tag.Array: {
+        const array = new Array(this.uvarint());
+        for (let i = 0; i < array.length; i++) {
+          array[i] = this.value();
+        }
+        return array;
+      }
+      case Tag.Object: {
+        const object: any = {};
+        for (let count = this.uvarint(); count > 0; count--) {
+          const key = this.key();
+          object[key] = this.value();
+        }
+        return object;
+      }
+      case Tag.Range: {
+        const index = this.uvarint();
+        return [this.ranges.starts[index], this.ranges.ends[index]];
+      }
+      default:
+        // tslint:disable-next-line:no-null-keyword
+        return null;
+    }
+  }
+
+  // Members are decoded on first access, other members are only skipped over.
+  public lazyObject(): any {
+    const object: any = {};
+    if (this.bytes[this.offset++] !== Tag.Object) {
+      throw new Error("Binary result is not an object.");
+    }
+    for (let count = this.uvarint(); count > 0; count--) {
+      const key = this.key();
+      const offset = this.offset;
+      this.skip();
+      const define = (value: any) => Object.defineProperty(object, key, {value, configurable: true, enumerable: true, writable: true});
+      Object.defineProperty(object, key, {
+        configurable: true,
+        enumerable: true,
+        get: () => {
+          const value = new BinaryReader(this.bytes, offset, this.ranges).value();
+          define(value);
+          return value;
+        },
+        set: define
+      });
+    }
+    return object;
+  }
+
+  private skip() {
+    switch (this.bytes[this.offset++]) {
+      case Tag.Int32:
+        this.offset += 4;
+        break;
+      case Tag.Double:
+        this.offset += 8;
+        break;
+      case Tag.Name:
+      case Tag.Range:
+        this.uvarint();
+        break;
+      case Tag.String: {
+        const length = this.uvarint();
+        this.offset += length;
+        break;
+      }
+      case Tag.Array:
+        for (let count = this.uvarint(); count > 0; count--) {
+          this.skip();
+        }
+        break;
+      case Tag.Object:
+        for (let count = this.uvarint(); count > 0; count--) {
+          const key = this.uvarint();
+          if (key % 2) {
+            this.offset += (key - 1) / 2;
+          }
+          this.skip();
+        }
+        break;
+    }
+  }
+
+  private key(): string {
+    const key = this.uvarint();
+    return key % 2 ? this.text((key - 1) / 2) : names[key / 2];
+  }
+
+  private text(length: number): string {
+    this.offset += length;
+    return textDecoder.decode(this.bytes.subarray(this.offset - length, this.offset));
+  }
+
+  private uvarint(): number {
+    let value = 0;
+    let scale = 1;
+    let byte: number;
+    do {
+      byte = this.bytes[this.offset++];
+      value += (byte & 0x7f) * scale;
+      scale *= 0x80;
+    } while (byte & 0x80);
+    return value;
+  }
+}
+
+// Reads the CBOR written by addon/cbor.cpp: maps and arrays of indefinite length, text,
+// integers, doubles and simple values.
+class CborReader {
+  private view: DataView;
+
+  constructor(private bytes: Uint8Array, public offset: number) {
+    this.view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+  }
+
+  public value(): any {
+    const head = this.bytes[this.offset++];
+    const major = head >> 5;
+    const info = head & 31;
+    if (major === 7) {
+      if (info === 27) {
+        this.offset += 8;
+        return this.view.getFloat64(this.offset - 8);
+      }
+      // tslint:disable-next-line:no-null-keyword
+      return info === 20 ? false : info === 21 ? true : null;
+    }
+    if (major === 4) {
+      const array: any[] = [];
+      while (this.bytes[this.offset] !== 0xff) {
+        array.push(this.value());
+      }
+      this.offset++;
+      return array;
+    }
+    if (major === 5) {
+      const object: any = {};
+      while (this.bytes[this.offset] !== 0xff) {
+        const key = this.value();
+        object[key] = this.value();
+      }
+      this.offset++;
+      return object;
+    }
+    const argument = this.argument(info);
+    if (major === 3) {
+      this.offset += argument;
+      return textDecoder.decode(this.bytes.subarray(this.offset - argument, this.offset));
+    }
+    return major === 1 ? -1 - argument : argument;
+  }
+
+  private argument(info: number): number {
+    if (info < 24) {
+      return info;
+    }
+    let value = 0;
+    for (let size = 1 << (info - 24); size > 0; size--) {
+      value = value * 256 + this.bytes[this.offset++];
+    }
+    return value;
+  }
+}
+
+/**
+ * Reads a buffer, binary or cbor result, on any thread. Members of binary results are decoded on first access.
+ */
+export const decode = (buffer: ArrayBuffer | Uint8Array): ParseResult => {
+  const bytes = buffer instanceof Uint8Array ? buffer : new Uint8Array(buffer);
+  if (bytes[0] === 0x7b) {
+    return JSON.parse(textDecoder.decode(bytes));
+  }
+  // Results always start with an indefinite length map in CBOR.
+  if (bytes[0] === 0xbf) {
+    return new CborReader(bytes, 0).value();
+  }
+  if (textDecoder.decode(bytes.subarray(0, 4)) !== "CYPB" || bytes[4] !== 2) {
+    throw new Error("Unknown result format.");
+  }
+  return new BinaryReader(bytes, 5, readRangeTables(bytes)).lazyObject();
+};
+
+/**
+ * Metrics of the parse function, kept for each thread loading the module.
+ */
+export const metrics = (): ParserMetrics => cypher.metrics();
+
+/**
+ * A parser set up once with its options, holding its own result cache, limits and metrics.
+ */
+export class CypherParser {
+  private native: any;
+
+  constructor(options: ParserParameters = {}) {
+    this.native = new cypher.CypherParser(options);
+  }
+
+  public parse(query: string): Promise<ParseResult> {
+    return new Promise<ParseResult>((resolve, reject) =>
+      this.native.parse(function(succeeded: boolean, result: ParseResult | Error) {
+        if (succeeded) {
+          resolve(result as ParseResult);
+        } else if (result instanceof Error) {
+          reject(result);
+        } else {
+          reject(new CypherParserError(result));
+        }
+      }, query)
+    );
+  }
+
+  public metrics(): ParserMetrics {
+    return this.native.metrics();
+  }
+}
+
+export const parseFile = (path: string | ParseFileParameters) => new Promise<ParseResult>((resolve, reject) =>
+  cypher.parseFile(function(succeeded: boolean, result: ParseResult | Error) {
+    if (succeeded) {
+      resolve(result as ParseResult);
+    } else if (result instanceof Error) {
+      reject(result);
+    } else {
+      reject(new CypherParserError(result));
+    }
+  }, path)
+);
+
+export const split = (query: string | SplitParameters) => new Promise<QuerySegment[]>((resolve, reject) =>
+  cypher.split(function(succeeded: boolean, segments: QuerySegment[]) {
+    if (succeeded) {
+      const text = typeof query === "string" ? query : query.query;
+      for (const segment of segments) {
+        segment.text = text.slice(segment.start, segment.end);
+      }
+      resolve(segments);
+    } else {
+      reject(new Error("Cypher Splitter Error"));
+    }
+  }, query)
+);
+
+/**
+ * Labels, relationship types, property keys, procedures and parameters a query refers to,
+ * each sorted, collected natively without building a result tree. Queries with syntax
+ * errors still resolve, with the names of what could be parsed and the number of errors.
+ */
+export const summarize = (query: string | AnalysisParameters) => new Promise<QuerySummary>((resolve, reject) =>
+  cypher.summarize(function(succeeded: boolean, result: QuerySummary | Error) {
+    if (result instanceof Error) {
+      reject(result);
+    } else {
+      resolve(result);
+    }
+  }, query)
+);
+
+/**
+ * Whether a query only reads, writes, changes the schema or calls procedures without writing,
+ * to route it to a read replica or the leader. The AST walk stops at the first write clause
+ * or schema command, and no result tree is built.
+ */
+export const classify = (query: string | AnalysisParameters) => new Promise<QueryClassification>((resolve, reject) =>
+  cypher.classify(function(succeeded: boolean, result: QueryClassification | Error) {
+    if (result instanceof Error) {
+      reject(result);
+    } else {
+      resolve(result);
+    }
+  }, query)
+);
+
+/**
+ * Scores query shapes known to be expensive whatever the data, for admission control: unbounded
+ * var-length relationships, hops of bounded ones, cartesian products between the paths of a MATCH,
+ * and elements of UNWIND literals. Computed natively without building a result tree.
+ */
+export const estimateCost = (query: string | CostParameters) => new Promise<QueryCost>((resolve, reject) =>
+  cypher.estimateCost(function(succeeded: boolean, result: QueryCost | Error) {
+    if (result instanceof Error) {
+      reject(result);
+    } else {
+      resolve(result);
+    }
+  }, query)
+);
+
+/**
+ * Calls back with every node of some types, as every apply-operator to audit function usage.
+ * The native walk only builds the subtrees of matching nodes, and they cross over to JS in
+ * one batch, so a query costs one crossing whatever the number of nodes.
+ */
+export const visit = <T extends ast.AstNode = ast.AstNode>(query: string | VisitParameters, options: VisitOptions,
+                                                            callback: (node: T) => void) =>
+  new Promise<VisitResult>((resolve, reject) =>
+    cypher.visit(function(succeeded: boolean, result: {nodes: T[], errors: ParseError[]} | Error) {
+      if (result instanceof Error) {
+        reject(result);
+        return;
+      }
+      try {
+        result.nodes.forEach(node => callback(node));
+        resolve({visited: result.nodes.length, errors: result.errors});
+      } catch (error) {
+        reject(error);
+      }
+    }, {...(typeof query === "string" ? {query} : query), types: options.types})
+  );
+
+/**
+ * Matches compiled selectors against a query natively, and only builds the matched nodes.
+ * Each node is matched once with the indices of all the selectors matching it.
+ */
+export const select = (query: string | VisitParameters, selectors: Selector[]) => new Promise<SelectResult>((resolve, reject) =>
+  cypher.select(function(succeeded: boolean, result: SelectResult | Error) {
+    if (result instanceof Error) {
+      reject(result);
+    } else {
+      resolve(result);
+    }
+  }, {...(typeof query === "string" ? {query} : query), selectors})
+);
+
+/**
+ * Adds predicates to MATCH clauses, labels to node patterns or renames variables, and renders
+ * the query back in the same native call, by editing its text at the ranges of the nodes changed.
+ * Queries with syntax errors are returned unchanged.
+ */
+export const rewrite = (query: string | AnalysisParameters, operations: RewriteOperation[]) =>
+  new Promise<RewriteResult>((resolve, reject) =>
+    cypher.rewrite(function(succeeded: boolean, result: RewriteResult | Error) {
+      if (result instanceof Error) {
+        reject(result);
+      } else {
+        resolve(result);
+      }
+    }, {...(typeof query === "string" ? {query} : query), operations})
+  );
+
+// Advances a position past some text, in string indices like the reported positions.
+const advance = (position: ParsePosition, text: string): ParsePosition => {
+  const lastLine = text.lastIndexOf("\n");
+  let line = position.line;
+  for (let i = text.indexOf("\n"); i !== -1; i = text.indexOf("\n", i + 1)) {
+    line++;
+  }
+  return {
+    line,
+    column: lastLine === -1 ? position.column + text.length : text.length - lastLine,
+    offset: position.offset + text.length
+  };
+};
+
+/**
+ * Parses a cypher script read from a stream, one statement at a time.
+ * Only the current incomplete statement is kept in memory, and the stream is not read
+ * while the consumer handles a result. Results are yielded even when they contain errors.
+ */
+export async function* parseStream(stream: Readable, options: StreamParameters = {}): AsyncIterableIterator<ParseResult> {
+  let buffer = "";
+  let position: ParsePosition = options.position || {line: 1, column: 1, offset: 0};
+  const flush = async function*(ended: boolean) {
+    const segments = await split({query: buffer, parseOnlyStatements: options.parseOnlyStatements});
+    const complete = ended ? segments.length : segments.length - 1;
+    let start = 0;
+    for (let i = 0; i < complete; i++) {
+      const end = i + 1 < segments.length ? segments[i + 1].start : buffer.length;
+      const text = buffer.slice(start, end);
+      yield await parse({...options, query: text, position}).catch((error) => {
+        if (error instanceof CypherParserError) {
+          return error.parseResult;
+        }
+        throw error;
+      });
+      position = advance(position, text);
+      start = end;
+    }
+    buffer = buffer.slice(start);
+  };
+
+  stream.setEncoding("utf8");
+  for await (const chunk of stream) {
+    buffer += chunk;
+    // Statements end at a semicolon and commands at the end of their line, so the buffer is
+    // only split again when the chunk can complete one, not for every chunk of a long statement.
+    if (chunk.includes(";") || (options.parseOnlyStatements === false && chunk.includes("\n") && /^\s*:/.test(buffer))) {
+      yield* flush(false);
+    }
+  }
+  yield* flush(true);
+}
+
+const lineStart = (text: string, offset: number) => text.lastIndexOf("\n", offset - 1) + 1;
+const countLines = (text: string) => text.split("\n").length - 1;
+
+/**
+ * A script kept parsed between edits, as in an editor session.
+ * Each statement is parsed on its own, and its result positions are relative to the statement.
+ * An edit only reparses the statements it changes, and resolves to a splice of the segments list.
+ */
+export class Document {
+  public text = "";
+  public segments: DocumentSegment[] = [];
+  private native: any;
+  private pending: Promise<any> = Promise.resolve();
+
+  constructor(options: DocumentParameters = {}) {
+    this.native = new cypher.Document(options);
+  }
+
+  /**
+   * Replaces the text between two string indices. Edits are applied in call order.
+   */
+  public edit(start: number, end: number, text: string): Promise<DocumentDelta> {
+    const edit = this.pending.then(() => new Promise<DocumentDelta>((resolve, reject) =>
+      this.native.edit((succeeded: boolean, delta: DocumentDelta) => {
+        if (succeeded) {
+          this.apply(start, end, text, delta);
+          resolve(delta);
+        } else {
+          reject(new Error("Cypher Document Error"));
+        }
+      }, start, end, text)
+    ));
+    this.pending = edit.catch(() => undefined);
+    return edit;
+  }
+
+  // Splices the delta in, and shifts the positions of the statements following the edit.
+  private apply(start: number, end: number, text: string, delta: DocumentDelta) {
+    const old = this.text;
+    this.text = old.slice(0, start) + text + old.slice(end);
+
+    const shift = text.length - (end - start);
+    const lines = countLines(text) - countLines(old.slice(start, end));
+    const columns = (start + text.length - lineStart(this.text, start + text.length)) - (end - lineStart(old, end));
+    const following = this.segments.slice(delta.index + delta.deleteCount);
+    for (const segment of following) {
+      if (old.lastIndexOf("\n", segment.start - 1) < end) {
+        segment.position.column += columns;
+      }
+      segment.start += shift;
+      segment.end += shift;
+      segment.position.line += lines;
+      segment.position.offset += shift;
+    }
+    this.segments.splice(delta.index, delta.deleteCount, ...delta.segments);
+  }
+}
@@ -1,5 +1,11 @@
 import "mocha";
 import { expect } from "chai";
+import * as fs from "fs";
+import * as os from "os";
+import * as path from "path";
+import { PassThrough } from "stream";
+import { Worker } from "worker_threads";
+import * as ast from "../src/ast";
 import * as cypher from "../src/index";
 
 const query = "MATCH (node1:Label1)-->(node2:Label2)\n" +
@@ -48,6 +54,170 @@ describe("cypher.parse", () => {
       expect(promise).to.be.a("promise");
       expect(result).to.be.a("string");
     });
+
+    it("should match the object result", async () => {
+      const raw = await cypher.parse({query, rawJson: true, ranges: true});
+      const result = await cypher.parse({query, ranges: true});
+      expect(JSON.parse(raw as any)).to.deep.equal(result);
+    });
+  });
+
+  describe("given compact option", () => {
+    it("should expand to the object result without nulls and empty arrays", async () => {
+      const mapQuery = "MATCH (n:Person {a: 1}) WHERE n.age > 1 + 2 RETURN n ORDER BY n.age";
+      const strip = (value: any): any => JSON.parse(JSON.stringify(value, (key, member) =>
+        member === null || (Array.isArray(member) && !member.length) ? undefined : member));
+      const compact = await cypher.parse({query: mapQuery, compact: true});
+      const result = await cypher.parse({query: mapQuery, fixedShapes: true});
+      expect(JSON.stringify(compact).length).to.be.below(JSON.stringify(result).length * 0.7);
+      expect(cypher.expand(compact)).to.deep.equal({...result, roots: strip(result.roots), directives: strip(result.directives)});
+    });
+  });
+
+  describe("given cbor format", () => {
+    it("should encode the object result", async () => {
+      const decodeCbor = (bytes: Buffer) => {
+        let offset = 0;
+        const argument = (info: number) => {
+          const size = info < 24 ? 0 : 1 << (info - 24);
+          let value = size ? 0 : info;
+          for (let i = 0; i < size; i++) {
+            value = value * 256 + bytes[offset++];
+          }
+          return value;
+        };
+        const item = (): any => {
+          const head = bytes[offset++];
+          const major = head >> 5;
+          const info = head & 31;
+          if (major === 7) {
+            offset += info === 27 ? 8 : 0;
+            // tslint:disable-next-line:no-null-keyword
+            return info === 27 ? bytes.readDoubleBE(offset - 8) : [false, true, null][info - 20];
+          }
+          if (info === 31) {
+            const items: any[] = [];
+            while (bytes[offset] !== 0xff) {
+              items.push(item());
+            }
+            offset++;
+            if (major === 4) {
+              return items;
+            }
+            const map: any = {};
+            for (let i = 0; i < items.length; i += 2) {
+              map[items[i]] = items[i + 1];
+            }
+            return map;
+          }
+          const value = argument(info);
+          if (major === 3) {
+            offset += value;
+            return bytes.toString("utf8", offset - value, offset);
+          }
+          return major === 1 ? -1 - value : value;
+        };
+        return item();
+      };
+      const result = await cypher.parse({query, ranges: true});
+      const cbor = await cypher.parseCbor({query, ranges: true});
+      expect(Buffer.isBuffer(cbor)).to.equal(true);
+      expect(decodeCbor(cbor)).to.deep.equal(result);
+      expect(cypher.decode(cbor)).to.deep.equal(result);
+    });
+
+    it("should reject failed parses with the decoded result", async () => {
+      const expected = await cypher.parse(badQuery).catch((e) => e.parseResult);
+      try {
+        await cypher.parseCbor(badQuery);
+        expect.fail();
+      }
+      catch (error) {
+        expect(error).to.be.an.instanceof(cypher.CypherParserError);
+        expect(error.parseResult.errors).to.not.be.empty;
+        expect(error.parseResult).to.deep.equal(expected);
+      }
+    });
+  });
+
+  describe("given format option", () => {
+    it("should decode buffer and binary results to the object result", async () => {
+      const result = await cypher.parse({query, ranges: true});
+      for (const format of ["buffer", "binary"] as const) {
+        const buffer = await cypher.parseTransferable({query, ranges: true, format});
+        expect(buffer).to.be.an.instanceof(ArrayBuffer);
+        expect(cypher.decode(buffer)).to.deep.equal(result);
+      }
+    });
+
+    it("should rebuild node ranges of binary results from their offset tables", async () => {
+      const result = await cypher.parse({query, ranges: true, compact: true});
+      const buffer = await cypher.parseTransferable({query, ranges: true, compact: true, format: "binary"});
+      const decoded = cypher.decode(buffer);
+      expect(decoded).to.deep.equal(result);
+      const expanded = cypher.expand(decoded);
+      const count = new DataView(buffer).getUint32(buffer.byteLength - 4, true);
+      expect(count).to.equal(JSON.stringify(expanded).split("\"range\":").length - 1);
+      const starts = Array.from(new Uint32Array(buffer, buffer.byteLength - 4 - count * 8, count));
+      const ends = Array.from(new Uint32Array(buffer, buffer.byteLength - 4 - count * 4, count));
+      const range = (expanded.roots[0] as any).range;
+      expect(starts.findIndex((start, i) => start === range[0] && ends[i] === range[1])).to.not.equal(-1);
+    });
+  });
+
+  describe("given ranges option", () => {
+    it("should add offsets to every node", async () => {
+      const result = await cypher.parse({query, ranges: true});
+      const match = (result.roots[0] as any).body.clauses[0];
+      expect(match.range).to.be.an("array").with.lengthOf(2);
+      expect(query.slice(match.pattern.range[0], match.pattern.range[1]).trim()).to.equal("(node1:Label1)-->(node2:Label2)");
+    });
+  });
+
+  describe("given fixedShapes option", () => {
+    it("should give nodes of a type the same members", async () => {
+      const result = await cypher.parse({query: "MATCH (a) WHERE a.x = 1 MATCH (b) RETURN a, b", fixedShapes: true});
+      const clauses = (result.roots[0] as any).body.clauses;
+      expect(Object.keys(clauses[1])).to.deep.equal(Object.keys(clauses[0]));
+      expect(clauses[1]).to.have.property("predicate").that.is.a("null");
+    });
+  });
+
+  describe("given non-ascii query", () => {
+    it("should report offsets as string indices", async () => {
+      const query = "MATCH (n {name: \"日本語 😀\"}) RETURN n";
+      const result = await cypher.parse({query, ranges: true});
+      const clauses = (result.roots[0] as any).body.clauses;
+      const name = clauses[0].pattern.paths[0].elements[0].properties.entries.name;
+      expect(name.range).to.deep.equal([query.indexOf("\""), query.indexOf("}")]);
+      expect(clauses[1].range).to.deep.equal([query.indexOf("RETURN"), query.length]);
+
+      const error = (await cypher.parse(query + " RETRN").catch((e) => e.parseResult)).errors[0];
+      expect(error.position).to.deep.equal({line: 1, column: query.length + 2, offset: query.length + 1});
+    });
+  });
+
+  describe("given threads option", () => {
+    it("should return statements in order with global error positions", async () => {
+      const statements: string[] = [];
+      for (let i = 0; i < 64; i++) {
+        statements.push("MATCH (n" + i + ") RETURN n" + i + ";");
+      }
+      const script = statements.join("\n") + "\n" + badQuery + ";";
+      try {
+        await cypher.parse({query: script, threads: 4});
+        expect.fail();
+      }
+      catch (error) {
+        const result: cypher.ParseResult = error.parseResult;
+        const sequential = await cypher.parse({query: script}).catch((e) => e.parseResult);
+        expect(result.directives).to.have.lengthOf(sequential.directives.length);
+        expect(result.roots).to.deep.equal(sequential.roots);
+        expect(result.nnodes).to.equal(sequential.nnodes);
+        expect(result.errors).to.deep.equal(sequential.errors);
+        expect(result.errors[0].position.line).to.equal(67);
+      }
+    });
   });
 
   describe("given bad query", () => {
@@ -77,4 +247,503 @@ describe("cypher.parse", () => {
       }
     });
   });
-});
\ No newline at end of file
+});
+
+describe("cypher.split", () => {
+
+  describe("given multiple statements", () => {
+    it("should return one segment per statement", async () => {
+      const script = query + ";\n" + query + ";";
+      const segments = await cypher.split(script);
+      expect(segments).to.be.an("array").with.lengthOf(2);
+      expect(segments[0].type).to.equal("statement");
+      expect(segments[0].text).to.equal(script.slice(segments[0].start, segments[0].end));
+      expect(segments[1].start).to.be.greaterThan(segments[0].end);
+    });
+  });
+
+  describe("given non-ascii input", () => {
+    it("should return string indices", async () => {
+      const script = "RETURN 'é😀';\nRETURN 1;";
+      const segments = await cypher.split(script);
+      expect(segments[1].text).to.match(/^RETURN 1;?$/);
+    });
+  });
+});
+
+describe("cypher.summarize", () => {
+
+  describe("given a query with parameters and a procedure call", () => {
+    it("should return the sorted names it refers to", async () => {
+      const summary = await cypher.summarize("MATCH (a:Person)-[:KNOWS]->(b:Person:Admin {name: $name}) " +
+        "CALL db.labels() YIELD label RETURN a.age, $limit");
+      expect(summary.labels).to.deep.equal(["Admin", "Person"]);
+      expect(summary.relTypes).to.deep.equal(["KNOWS"]);
+      expect(summary.propertyKeys).to.deep.equal(["age", "name"]);
+      expect(summary.procedures).to.deep.equal(["db.labels"]);
+      expect(summary.parameters).to.deep.equal(["limit", "name"]);
+      expect(summary.errors).to.equal(0);
+    });
+  });
+
+  describe("given bad query", () => {
+    it("should count the errors", async () => {
+      const summary = await cypher.summarize(badQuery);
+      expect(summary.errors).to.be.greaterThan(0);
+    });
+  });
+});
+
+describe("cypher.classify", () => {
+
+  describe("given queries of each kind", () => {
+    it("should return their kind", async () => {
+      expect((await cypher.classify(query)).kind).to.equal("read");
+      expect((await cypher.classify("MATCH (n) FOREACH (x IN [1] | SET n.x = x)")).kind).to.equal("write");
+      expect((await cypher.classify("CREATE INDEX ON :Person(name)")).kind).to.equal("schema");
+      expect((await cypher.classify("CALL db.labels() YIELD label RETURN label")).kind).to.equal("procedure");
+      expect((await cypher.classify("CALL db.labels() YIELD label CREATE (:Label {name: label})")).kind).to.equal("write");
+    });
+  });
+});
+
+describe("cypher.estimateCost", () => {
+
+  describe("given a pathological query", () => {
+    it("should score each factor", async () => {
+      const cost = await cypher.estimateCost("MATCH (a)-[*]->(b), (c:Label) UNWIND [1, 2, 3, 4] AS x RETURN a, c, x");
+      expect(cost.factors.map(factor => factor.name)).to.have.members(["unboundedRange", "cartesianProducts", "unwindElements"]);
+      expect(cost.factors.find(factor => factor.name === "unwindElements")!.count).to.equal(4);
+      expect(cost.score).to.equal(100 + 50 + 0.04);
+    });
+  });
+
+  describe("given weights", () => {
+    it("should use them", async () => {
+      const cost = await cypher.estimateCost({query: "MATCH (a)-[*1..5]->(b) RETURN b", weights: {rangeHop: 3}});
+      expect(cost.factors).to.deep.equal([{name: "rangeHops", count: 5, score: 15}]);
+      expect(cost.score).to.equal(15);
+    });
+  });
+
+  describe("given range() calls", () => {
+    it("should count their elements without overflowing", async () => {
+      const count = async (call: string) => (await cypher.estimateCost("UNWIND " + call + " AS x RETURN x")).factors
+        .reduce((total, factor) => total + factor.count, 0);
+      expect(await count("range(1, 10, 3)")).to.equal(4);
+      expect(await count("range(0, 5, 2)")).to.equal(3);
+      expect(await count("range(0, -1, 2)")).to.equal(0);
+      expect(await count("range(0, 9223372036854775807)")).to.equal(9223372036854775808);
+    });
+  });
+});
+
+describe("cypher.visit", () => {
+
+  describe("given a query with nested function calls", () => {
+    it("should call back with every node of the types asked for", async () => {
+      const names: string[] = [];
+      const result = await cypher.visit<ast.ApplyOperator>("MATCH (n) RETURN toUpper(trim(n.name)), count(*)",
+        {types: ["apply-operator", "apply-all-operator"]}, node => names.push(node.funcName.value));
+      expect(names).to.deep.equal(["toUpper", "trim", "count"]);
+      expect(result).to.deep.equal({visited: 3, errors: []});
+    });
+  });
+
+  describe("given an unknown node type", () => {
+    it("should reject with an error", async () => {
+      try {
+        await cypher.visit("RETURN 1", {types: ["function-call"]}, () => undefined);
+        expect.fail();
+      }
+      catch (error) {
+        expect(error.message).to.contain("Unknown AST node type");
+      }
+    });
+  });
+});
+
+describe("cypher.select", () => {
+
+  describe("given compiled selectors", () => {
+    it("should return the matched nodes with their paths", async () => {
+      const selectors = [
+        cypher.compileSelector("match > pattern rel-pattern[varLength]"),
+        cypher.compileSelector("apply-operator[funcName=apoc.*]")
+      ];
+      const result = await cypher.select("MATCH (a)-[*]->(b), (c)-[:R]->(d) RETURN apoc.text.join([a.name], ','), toUpper(c.name)",
+        selectors);
+      expect(result.errors).to.be.empty;
+      expect(result.matches.map(match => [match.node.type, match.selectors])).to.deep.equal([
+        ["rel-pattern", [0]], ["apply-operator", [1]]
+      ]);
+      expect(result.matches[0].path).to.deep.equal(["statement", "query", "match", "pattern", "pattern-path", "rel-pattern"]);
+    });
+  });
+
+  describe("given selectors on operators, map entries and case alternatives", () => {
+    it("should match them by name", async () => {
+      const selectors = [
+        cypher.compileSelector("map[entries=name]"),
+        cypher.compileSelector("case[alternatives=yes]"),
+        cypher.compileSelector("binary-operator[op=plus]")
+      ];
+      const result = await cypher.select("RETURN {name: 'a'} AS m, CASE WHEN true THEN 'yes' END AS c, 1 + 2 AS s", selectors);
+      expect(result.matches.map(match => [match.node.type, match.selectors])).to.deep.equal([
+        ["map", [0]], ["case", [1]], ["binary-operator", [2]]
+      ]);
+    });
+  });
+
+  describe("given the members of parse results", () => {
+    it("should have an attribute for each of them", async () => {
+      const queries = [
+        query,
+        "MATCH (a:A {x: 1})<-[r:R*1..2]-(b) WHERE 1 < a.x <= 3 AND NOT b:B\n" +
+          "RETURN DISTINCT CASE a.x WHEN 1 THEN 'one' ELSE 'other' END AS c, -a.y ORDER BY c SKIP 1 LIMIT 2",
+        "CYPHER 3.5 planner=cost UNWIND [1, 2] AS x WITH x, {k: x} AS m WHERE m.k > 1\n" +
+          "RETURN [y IN range(1, x) WHERE y > 0 | y * 2], reduce(s = 0, y IN [x] | s + y), m {.k, z: 1, x, .*}, count(*)",
+        "MERGE (n:N {id: $id}) ON CREATE SET n.created = timestamp() ON MATCH SET n += {seen: true}\n" +
+          "WITH n CALL db.labels() YIELD label REMOVE n:Old, n.x DETACH DELETE n",
+        "MATCH p = shortestPath((a)-[*]-(b)) FOREACH (n IN nodes(p) | SET n.visited = true, n:Seen, n = {})\n" +
+          "RETURN p, [(a)-->(c) WHERE c.x | c.y], any(z IN [1] WHERE z = 1), a.list[0..1][0], a.x =~ 'x.*', a.y IS NULL",
+        "LOAD CSV WITH HEADERS FROM 'file:///a.csv' AS row FIELDTERMINATOR ';' CREATE (:Row {name: row.name})\n" +
+          "UNION ALL MATCH (n) USING INDEX n:N(id) USING SCAN n:N USING JOIN ON n RETURN *, 1.5",
+        "START n = node(1), m = node:idx(k = 'v'), r = rel(*) WHERE n.x RETURN n",
+        "CREATE CONSTRAINT ON (n:N) ASSERT n.id IS UNIQUE",
+        "CREATE INDEX ON :N(id)",
+        "EXPLAIN MATCH (n) RETURN n /* block */",
+        ":help match // line"
+      ];
+      const members = new Set<string>();
+      const collect = (value: any) => {
+        if (Array.isArray(value)) {
+          value.forEach(collect);
+        }
+        else if (value && typeof value === "object") {
+          for (const key of Object.keys(value)) {
+            if (typeof value.type === "string" && key !== "type") {
+              members.add(`${value.type}[${key}]`);
+            }
+            collect(value[key]);
+          }
+        }
+      };
+      for (const text of queries) {
+        collect((await cypher.parse(text)).roots);
+      }
+      for (const member of members) {
+        expect(() => cypher.compileSelector(member), member).to.not.throw();
+      }
+    });
+  });
+
+  describe("given an invalid selector", () => {
+    it("should throw", () => {
+      expect(() => cypher.compileSelector("apply-operator[optional]")).to.throw("Unknown attribute optional");
+    });
+  });
+});
+
+describe("cypher.rewrite", () => {
+
+  describe("given tenant isolation operations", () => {
+    it("should render the rewritten query", async () => {
+      const result = await cypher.rewrite("MATCH (n:Person) WHERE n.age > 30 OR n.vip\nMATCH (m) CREATE (n)-[:KNOWS]->(:Person {name: m.name})", [
+        {type: "add-predicate", predicate: "n.tenant = $tenant"},
+        {type: "add-label", label: "Tenant1", selector: cypher.compileSelector("create node-pattern")},
+        {type: "rename", from: "m", to: "friend"}
+      ]);
+      expect(result.query).to.equal("MATCH (n:Person) WHERE (n.age > 30 OR n.vip) AND (n.tenant = $tenant)\n" +
+        "MATCH (friend) WHERE n.tenant = $tenant CREATE (n)-[:KNOWS]->(:Person:Tenant1 {name: friend.name})");
+      expect(result.edits).to.equal(6);
+      expect(result.errors).to.equal(0);
+    });
+  });
+
+  describe("given a variable name reused in a nested scope", () => {
+    it("should only rename the variable bound first and keep result columns", async () => {
+      const result = await cypher.rewrite("MATCH (m) WITH m, [m IN range(1, 2) | m * 2] AS doubled RETURN m, doubled",
+        [{type: "rename", from: "m", to: "friend", selector: undefined}]);
+      expect(result.query).to.equal("MATCH (friend) WITH friend, [m IN range(1, 2) | m * 2] AS doubled RETURN friend AS m, doubled");
+      expect(result.edits).to.equal(4);
+    });
+  });
+
+  describe("given clauses followed by comments", () => {
+    it("should insert predicates before the comments", async () => {
+      const tenant = [{type: "add-predicate" as const, predicate: "n.tenant = $tenant"}];
+      const line = await cypher.rewrite("MATCH (n) // all nodes\nRETURN n", tenant);
+      expect(line.query).to.equal("MATCH (n) WHERE n.tenant = $tenant // all nodes\nRETURN n");
+      const block = await cypher.rewrite("MATCH (n) WHERE n.age > 30 /* adults */ RETURN n", tenant);
+      expect(block.query).to.equal("MATCH (n) WHERE (n.age > 30) AND (n.tenant = $tenant) /* adults */ RETURN n");
+    });
+  });
+});
+
+describe("cypher.parseStream", () => {
+
+  describe("given a script split in small chunks", () => {
+    it("should yield one result per statement with global positions", async () => {
+      const script = "MATCH (n) RETURN n;\nMATCH (m)\nRETURN m;\n" + badQuery + ";";
+      const stream = new PassThrough();
+      for (let i = 0; i < script.length; i += 7) {
+        stream.write(script.slice(i, i + 7));
+      }
+      stream.end();
+
+      const results: cypher.ParseResult[] = [];
+      for await (const result of cypher.parseStream(stream)) {
+        results.push(result);
+      }
+      expect(results).to.have.lengthOf(3);
+      expect(results[0].errors).to.be.empty;
+      expect(results[1].errors).to.be.empty;
+      expect(results[2].errors[0].position.line).to.equal(6);
+    });
+  });
+});
+
+describe("cypher.CypherParser", () => {
+
+  describe("given a cache and limits", () => {
+    it("should reuse results, reject long queries and count them", async () => {
+      const parser = new cypher.CypherParser({cacheSize: 4, maxQueryLength: 256});
+      const first = await parser.parse(query);
+      expect(await parser.parse(query)).to.deep.equal(first);
+      try {
+        await parser.parse("RETURN " + "1 + ".repeat(80) + "1");
+        expect.fail();
+      }
+      catch (error) {
+        expect(error).to.be.an("error");
+        expect(error).to.not.have.property("parseResult");
+      }
+      expect(parser.metrics()).to.include({parses: 1, cacheHits: 1, rejected: 1});
+    });
+  });
+});
+
+describe("lint option", () => {
+
+  describe("given a parser with lint rules", () => {
+    it("should report diagnostics like errors", async () => {
+      const parser = new cypher.CypherParser({lint: ["missing-limit", "leading-optional-match", "unbound-identifier"]});
+      const result = await parser.parse("OPTIONAL MATCH (n)\nWITH n.name AS name\nRETURN name, n.age");
+      expect(result.errors).to.be.empty;
+      expect(result.diagnostics!.map(diagnostic => diagnostic.rule))
+        .to.deep.equal(["leading-optional-match", "missing-limit", "unbound-identifier"]);
+      const unbound = result.diagnostics![2];
+      expect(unbound.position).to.deep.equal({line: 3, column: 14, offset: 52});
+      expect(unbound.context).to.equal("RETURN name, n.age");
+      expect(unbound.contextOffset).to.equal(13);
+    });
+  });
+
+  describe("given a variable used outside of its comprehension", () => {
+    it("should report the access as unbound", async () => {
+      const parser = new cypher.CypherParser({lint: ["unbound-identifier"]});
+      const result = await parser.parse("MATCH (n) RETURN [x IN n.list | x.a] AS a, x.b LIMIT 1");
+      expect(result.diagnostics!.map(diagnostic => [diagnostic.rule, diagnostic.position.offset]))
+        .to.deep.equal([["unbound-identifier", 43]]);
+    });
+  });
+
+  describe("given a script parsed on threads", () => {
+    it("should report each diagnostic once", async () => {
+      const statements = Array.from({length: 16}, (_, i) => "MATCH (n" + i + ") RETURN n" + i + ";");
+      const result = await cypher.parse({query: statements.join("\n"), lint: ["missing-limit"], threads: 2});
+      expect(result.directives).to.have.lengthOf(16);
+      expect(result.diagnostics!.map(diagnostic => diagnostic.position.line))
+        .to.deep.equal(Array.from({length: 16}, (_, i) => i + 1));
+    });
+  });
+
+  describe("given no lint rules", () => {
+    it("should not add diagnostics", async () => {
+      const result = await cypher.parse("MATCH (n) RETURN n");
+      expect(result).to.not.have.property("diagnostics");
+    });
+  });
+});
+
+describe("scopes option", () => {
+
+  describe("given a query with nested scopes", () => {
+    it("should resolve identifiers and report unbound and shadowed variables", async () => {
+      const result = await cypher.parse({
+        query: "MATCH (n) WITH n, n.name AS name RETURN [n IN range(1, 3) | n + size(name)] AS sizes, m",
+        scopes: true
+      });
+      expect(result.bindings!.map(binding => [binding.name, binding.kind, binding.position.offset])).to.deep.equal([
+        ["n", "match", 7], ["name", "with", 28], ["n", "list-comprehension", 41], ["sizes", "return", 79]
+      ]);
+      const returned: any = (result.roots[0] as any).body.clauses[2];
+      const evaluated: any = returned.projections[0].expression.eval;
+      expect(evaluated.arg1.binding).to.equal(41);
+      expect(evaluated.arg2.args[0].binding).to.equal(28);
+      expect((result.directives[0] as any).body.clauses[2]).to.deep.equal(returned);
+      expect(result.bindings).to.have.lengthOf(4);
+      expect(result.diagnostics!.map(diagnostic => diagnostic.rule)).to.deep.equal(["shadowed-variable", "unbound-variable"]);
+    });
+  });
+});
+
+describe("normalize option", () => {
+
+  describe("given queries differing only in foldable expressions", () => {
+    it("should fold them and share a fingerprint", async () => {
+      const generated = await cypher.parse({
+        query: "MATCH (n)  WHERE 1 + 1 = 2 AND NOT NOT n.x > 1 // generated\nRETURN 'a' + 'b' AS s, n.y IN [2 * 3] AS y",
+        normalize: true
+      });
+      const written = await cypher.parse({query: "MATCH (n) WHERE n.x > 1 RETURN 'ab' AS s, n.y = 6 AS y", normalize: true});
+      const clauses: any[] = (generated.directives[0] as any).body.clauses;
+      expect(clauses[0].predicate.type).to.equal("comparison");
+      expect(clauses[1].projections[0].expression).to.deep.equal({type: "string", value: "ab"});
+      expect(generated.fingerprint).to.match(/^[0-9a-f]{16}$/);
+      expect(generated.fingerprint).to.equal(written.fingerprint);
+
+      const other = await cypher.parse({query: "MATCH (n) WHERE n.x > 1 RETURN 'ac' AS s, n.y = 6 AS y", normalize: true});
+      expect(other.fingerprint).to.not.equal(written.fingerprint);
+      const always = await cypher.parse({query: "MATCH (n) WHERE 1 < 2 RETURN n", normalize: true});
+      expect((always.directives[0] as any).body.clauses[0]).to.not.have.property("predicate");
+    });
+  });
+
+  describe("given operands which may not be booleans", () => {
+    it("should keep the operators failing on them", async () => {
+      const result = await cypher.parse({query: "MATCH (n) WHERE NOT NOT n.x RETURN n.y AND true AS y", normalize: true});
+      const clauses: any[] = (result.directives[0] as any).body.clauses;
+      expect(clauses[0].predicate).to.include({type: "unary-operator", op: "not"});
+      expect(clauses[1].projections[0].expression).to.include({type: "binary-operator", op: "and"});
+    });
+  });
+
+  describe("given folded columns without an alias", () => {
+    it("should keep their names and fingerprints apart", async () => {
+      const folded = await cypher.parse({query: "MATCH (n) RETURN n.y IN [2 * 3]", normalize: true});
+      const written = await cypher.parse({query: "MATCH (n) RETURN n.y = 6", normalize: true});
+      const projection: any = (folded.directives[0] as any).body.clauses[1].projections[0];
+      expect(projection.expression.type).to.equal("comparison");
+      expect(projection.alias).to.deep.equal({type: "identifier", name: "n.y IN [2 * 3]"});
+      expect(folded.fingerprint).to.not.equal(written.fingerprint);
+    });
+  });
+});
+
+describe("cypher.compileSchema", () => {
+
+  describe("given a parse with a schema", () => {
+    it("should report names missing from the schema", async () => {
+      const schema = cypher.compileSchema({
+        labels: {Person: ["name", "born"], Movie: ["title"]},
+        relTypes: {ACTED_IN: ["roles"]}
+      });
+      expect(schema).to.include({labels: 2, relTypes: 1, properties: 4});
+      const result = await cypher.parse({
+        query: "MATCH (p:Person {name: $name})-[:DIRECTED]->(m:Film) WHERE m.title = p.title RETURN p.born",
+        schema
+      });
+      expect(result.diagnostics!.map(diagnostic => diagnostic.rule)).to.deep.equal(["unknown-rel-type", "unknown-label", "unknown-property"]);
+      expect(result.diagnostics![2].message).to.equal("Property `title` is not in the schema.");
+      expect(result.diagnostics![2].position.offset).to.equal(71);
+    });
+  });
+});
+
+describe("worker_threads", () => {
+
+  describe("given the module loaded in several workers", () => {
+    it("should parse concurrently with metrics kept per worker", async () => {
+      const code = `
+        const { parentPort, workerData } = require("worker_threads");
+        const cypher = require(workerData.module);
+        Promise.all(Array.from({length: 16}, () => cypher.parse(workerData.query)))
+          .then((results) => parentPort.postMessage({result: results[15], metrics: cypher.metrics()}));
+      `;
+      const workerData = {module: path.resolve(__dirname, "../dist/index.js"), query};
+      const expected = await cypher.parse(query);
+      const messages = await Promise.all(Array.from({length: 4}, () => new Promise<any>((resolve, reject) => {
+        const worker = new Worker(code, {eval: true, workerData});
+        worker.once("message", resolve);
+        worker.once("error", reject);
+      })));
+      for (const message of messages) {
+        expect(message.result).to.deep.equal(expected);
+        expect(message.metrics.parses).to.equal(16);
+      }
+    });
+  });
+
+  describe("given a binary result transferred from a worker", () => {
+    it("should decode on the receiving thread", async () => {
+      const code = `
+        const { parentPort, workerData } = require("worker_threads");
+        const cypher = require(workerData.module);
+        cypher.parseTransferable({query: workerData.query, format: "binary"})
+          .then((buffer) => parentPort.postMessage(buffer, [buffer]));
+      `;
+      const workerData = {module: path.resolve(__dirname, "../dist/index.js"), query};
+      const buffer = await new Promise<ArrayBuffer>((resolve, reject) => {
+        const worker = new Worker(code, {eval: true, workerData});
+        worker.once("message", resolve);
+        worker.once("error", reject);
+      });
+      expect(cypher.decode(buffer)).to.deep.equal(await cypher.parse(query));
+    });
+  });
+});
+
+describe("cypher.Document", () => {
+
+  describe("given an edit inside one statement", () => {
+    it("should only reparse that statement", async () => {
+      const document = new cypher.Document();
+      const script = "MATCH (a) RETURN a;\nMATCH (b) RETURN b;\nMATCH (c) RETURN c;";
+      const initial = await document.edit(0, 0, script);
+      expect(initial.segments).to.have.lengthOf(3);
+
+      const offset = script.indexOf("(b)") + 2;
+      const delta = await document.edit(offset, offset, "bb");
+      expect(delta.index).to.equal(1);
+      expect(delta.deleteCount).to.equal(1);
+      expect(delta.segments).to.have.lengthOf(1);
+      expect(delta.segments[0].result.errors).to.have.lengthOf(0);
+
+      const last = document.segments[2];
+      expect(document.text.slice(last.start, last.end)).to.match(/^MATCH \(c\) RETURN c;?$/);
+      expect(last.position).to.deep.equal({line: 3, column: 1, offset: last.start});
+    });
+  });
+});
+
+describe("cypher.parseFile", () => {
+
+  describe("given a cypher file", () => {
+    it("should return the same result as parse", async () => {
+      const file = path.join(os.tmpdir(), "cypher-parser-" + process.pid + ".cypher");
+      fs.writeFileSync(file, query);
+      try {
+        const result = await cypher.parseFile(file);
+        expect(result).to.deep.equal(await cypher.parse(query));
+      }
+      finally {
+        fs.unlinkSync(file);
+      }
+    });
+  });
+
+  describe("given a missing file", () => {
+    it("should reject with an error", async () => {
+      try {
+        await cypher.parseFile("/does/not/exist.cypher");
+        expect.fail();
+      }
+      catch (error) {
+        expect(error).not.to.have.property("parseResult");
+        expect(error.message).to.contain("/does/not/exist.cypher");
+      }
+    });
+  });
+});